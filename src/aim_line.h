@@ -0,0 +1,82 @@
+#ifndef AIM_LINE_H
+#define AIM_LINE_H
+
+#include <vector>
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "texture.h"
+#include "mesh.h"
+#include "entity.h"
+#include "physics/aim_predictor.h"
+
+
+const float AIM_DOT_SPACING = 5.0f;   // Table units between two dots of a path
+const float AIM_DOT_SCALE = 0.15f;    // Size of a dot relative to a ball
+
+
+// Render view of an AimPrediction : dotted paths made of small balls, and a ghost
+// ball where the cue ball touches the object ball
+class AimLine
+{
+public:
+    bool visible = false;
+
+    AimLine(Mesh& ballMesh, Texture texture) : dot(ballMesh, texture), ghost(ballMesh, texture) {
+
+    }
+
+    void computeTransforms(const AimPrediction& prediction, glm::mat4 table_transform, glm::vec3 table_dim, glm::vec3 coord_res) {
+        glm::vec3 res = table_dim/coord_res;
+        dots.clear();
+
+        for (const AimPath* path : {&prediction.cue, &prediction.object, &prediction.cueAfter}) {
+            addDots(*path, table_transform, res, coord_res);
+        }
+
+        showGhost = prediction.hit();
+        if (showGhost) {
+            glm::vec2 position = prediction.cue.end();
+            ghost.transform = table_transform * glm::translate(glm::mat4(1.0f), glm::vec3(position.y, coord_res.y, position.x) * res);
+        }
+    }
+
+    void draw(Shader& shader) {
+        if (!visible) return;
+
+        for (const glm::mat4& transform : dots) {
+            dot.transform = transform;
+            dot.draw(shader);
+        }
+        if (showGhost) ghost.draw(shader);
+    }
+
+private:
+    Entity dot;
+    Entity ghost;
+    std::vector<glm::mat4> dots;
+    bool showGhost = false;
+
+    void addDots(const AimPath& path, glm::mat4 table_transform, glm::vec3 res, glm::vec3 coord_res) {
+        // The spacing carries over the bounces, so that the dots stay evenly spaced
+        float offset = 0.0f;
+        for (int s = 1; s < (int)path.points.size(); s++) {
+            glm::vec2 a = path.points[s - 1];
+            glm::vec2 b = path.points[s];
+            float length = glm::length(b - a);
+
+            for (; offset < length; offset += AIM_DOT_SPACING) {
+                glm::vec2 position = a + (b - a) * (offset / length);
+                glm::mat4 relativePos = glm::translate(glm::mat4(1.0f), glm::vec3(position.y, coord_res.y, position.x) * res);
+                dots.push_back(table_transform * glm::scale(relativePos, glm::vec3(AIM_DOT_SCALE)));
+            }
+            offset -= length;
+        }
+    }
+};
+
+#endif /* AIM_LINE_H */
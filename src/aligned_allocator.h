@@ -0,0 +1,50 @@
+#ifndef ALIGNED_ALLOCATOR_H
+#define ALIGNED_ALLOCATOR_H
+
+// Allocator of std::vector giving memory aligned on Alignment bytes (a power of two),
+// for arrays copied to the GPU or read with vector instructions.
+// C++14 operator new only guarantees the alignment of the fundamental types
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+
+template<typename T, size_t Alignment>
+struct AlignedAllocator {
+    typedef T value_type;
+
+    template<typename U>
+    struct rebind {
+        typedef AlignedAllocator<U, Alignment> other;
+    };
+
+    AlignedAllocator() {}
+
+    template<typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+    T* allocate(size_t n) {
+        // The address of the block returned by operator new is kept just before the aligned memory
+        void* block = ::operator new(n * sizeof(T) + Alignment + sizeof(void*));
+        uintptr_t address = ((uintptr_t)block + sizeof(void*) + Alignment - 1) & ~(uintptr_t)(Alignment - 1);
+        ((void**)address)[-1] = block;
+        return (T*)address;
+    }
+
+    void deallocate(T* p, size_t) {
+        ::operator delete(((void**)p)[-1]);
+    }
+
+    template<typename U>
+    bool operator==(const AlignedAllocator<U, Alignment>&) const {
+        return true;
+    }
+
+    template<typename U>
+    bool operator!=(const AlignedAllocator<U, Alignment>&) const {
+        return false;
+    }
+};
+
+#endif /* ALIGNED_ALLOCATOR_H */
@@ -0,0 +1,158 @@
+#ifndef BALL_TRANSFORMS_H
+#define BALL_TRANSFORMS_H
+
+#include <vector>
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "aligned_allocator.h"
+#include "ball.h"
+
+
+// Texture unit of the ball matrices (u_ballMatrices) in the shaders that draw the balls
+const int BALL_MATRIX_UNIT = 3;
+
+
+// World and normal matrices of all the balls, built in one pass into one array :
+// the model matrices of the balls, then their normal matrices. The array is aligned
+// on 64 bytes and contiguous, and sent with a single buffer write (BallMatrixBuffer).
+// The terms shared by the balls (table transform, table scale) are computed once
+class BallTransforms
+{
+public:
+    typedef std::vector<glm::mat4, AlignedAllocator<glm::mat4, 64>> MatrixArray;
+
+    // scale : size of the simulated table relative to the table mesh (sandbox), the
+    // balls are drawn smaller by as much so that the whole table fits on the mesh
+    void setTable(glm::mat4 table_transform, glm::vec3 table_dim, glm::vec3 coord_res, float scale = 1.0f) {
+        if (table_transform == tableTransform && table_dim / coord_res == res && 1.0f / scale == invScale) return;
+
+        tableTransform = table_transform;
+        // Balls only rotate, translate and scale uniformly : the normal matrix of a ball is
+        // the one of the table times its rotation (exact in the rows used by the shaders,
+        // up to the length that the shaders normalize)
+        tableNormal = glm::transpose(glm::inverse(table_transform));
+        res = table_dim / coord_res;
+        height = coord_res.y * res.y;
+        invScale = 1.0f / scale;
+        tableChanged = true;
+    }
+
+    // Build the matrices of the balls that moved, false if none did
+    bool build(std::vector<PoolBall>& balls) {
+        int count = (int)balls.size();
+        if ((int)matrices.size() != 2 * count) {
+            matrices.resize(2 * count);
+            tableChanged = true;
+        }
+
+        bool built = false;
+        glm::mat4* models = matrices.data();
+        glm::mat4* normals = models + count;
+
+        for (int i = 0; i < count; i++) {
+            PoolBall& ball = balls[i];
+            if (!ball.dirty && !tableChanged) continue;
+
+            glm::mat4 local = glm::mat4_cast(ball.Rotation) * invScale;
+            glm::vec3 position = glm::vec3(ball.Position.y, ball.Position.z, ball.Position.x) * res * invScale;
+            local[3] = glm::vec4(position.x, position.y + height, position.z, 1.0f);
+
+            models[i] = tableTransform * local;
+            normals[i] = tableNormal * glm::mat4_cast(ball.Rotation);
+            ball.dirty = false;
+            built = true;
+        }
+        tableChanged = false;
+        return built;
+    }
+
+    int size() const {
+        return (int)matrices.size() / 2;
+    }
+
+    const glm::mat4& model(int i) const {
+        return matrices[i];
+    }
+
+    const glm::mat4& normal(int i) const {
+        return matrices[size() + i];
+    }
+
+    // The whole array, for a buffer upload
+    const float* data() const {
+        return &matrices[0][0][0];
+    }
+
+    size_t bytes() const {
+        return matrices.size() * sizeof(glm::mat4);
+    }
+
+private:
+    MatrixArray matrices;
+
+    glm::mat4 tableTransform = glm::mat4(0.0f);
+    glm::mat4 tableNormal = glm::mat4(1.0f);
+    glm::vec3 res = glm::vec3(0.0f);
+    float height = 0.0f;        // Of the surface of the table
+    float invScale = 1.0f;
+    bool tableChanged = true;
+};
+
+
+// The matrices of BallTransforms on the GPU, in a texture buffer of RGBA32F texels (one
+// per column). The vertex shaders read the matrices of the ball u_ball - 1 from it
+// (u_ball = 0 : the M and itM uniforms), so that drawing a ball only sets its index
+class BallMatrixBuffer
+{
+public:
+    BallMatrixBuffer() {}
+    BallMatrixBuffer(const BallMatrixBuffer&) = delete;
+    BallMatrixBuffer& operator=(const BallMatrixBuffer&) = delete;
+
+    ~BallMatrixBuffer() {
+        if (!buffer) return;
+        glDeleteTextures(1, &texture);
+        glDeleteBuffers(1, &buffer);
+    }
+
+    void upload(const BallTransforms& transforms) {
+        if (!buffer) {
+            glGenBuffers(1, &buffer);
+            glGenTextures(1, &texture);
+        }
+
+        glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+        if (transforms.bytes() != bytes) {
+            // Sized to the array : the shaders count the balls from the size of the buffer
+            bytes = transforms.bytes();
+            glBufferData(GL_TEXTURE_BUFFER, bytes, transforms.data(), GL_STREAM_DRAW);
+
+            glActiveTexture(GL_TEXTURE0 + BALL_MATRIX_UNIT);
+            glBindTexture(GL_TEXTURE_BUFFER, texture);
+            glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, buffer);
+            glActiveTexture(GL_TEXTURE0);
+        }
+        else {
+            glBufferSubData(GL_TEXTURE_BUFFER, 0, bytes, transforms.data());
+        }
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+
+    void bind() const {
+        glActiveTexture(GL_TEXTURE0 + BALL_MATRIX_UNIT);
+        glBindTexture(GL_TEXTURE_BUFFER, texture);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+private:
+    GLuint buffer = 0;
+    GLuint texture = 0;
+    size_t bytes = 0;
+};
+
+#endif /* BALL_TRANSFORMS_H */
@@ -0,0 +1,99 @@
+// Compare the brute-force and uniform grid broadphases on random tables of
+// increasing ball counts, and report where the grid becomes faster.
+//
+// usage : bench_broadphase [max balls]
+
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <chrono>
+#include <vector>
+#include <cstdlib>
+
+#include "ball_state.h"
+#include "broadphase.h"
+
+const float BENCH_RADIUS = 2.7f;
+const float BENCH_MAX_X = 50.0f;    // COORD_RES.z / 2
+const float BENCH_MAX_Y = 100.0f;   // COORD_RES.x / 2
+
+
+// Random scatter of count balls, the table is scaled to keep the density of a 16 balls table
+void scatterBalls(BallState& state, int count, float& maxX, float& maxY, std::mt19937& rng) {
+    float scale = glm::sqrt(glm::max(1.0f, count / 16.0f));
+    maxX = BENCH_MAX_X * scale;
+    maxY = BENCH_MAX_Y * scale;
+
+    std::uniform_real_distribution<float> randX(-maxX + BENCH_RADIUS, maxX - BENCH_RADIUS);
+    std::uniform_real_distribution<float> randY(-maxY + BENCH_RADIUS, maxY - BENCH_RADIUS);
+
+    state = BallState();
+    for (int i = 0; i < count; i++) {
+        int index = state.add(BENCH_RADIUS, 1.0f);
+        state.reset(index, randX(rng), randY(rng));
+    }
+}
+
+// Average time of findPairs + narrow test, in nanoseconds
+double timeBroadphase(Broadphase& broadphase, const BallState& state, int iterations, int& contacts) {
+    std::vector<BallPair> pairs;
+    contacts = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int it = 0; it < iterations; it++) {
+        broadphase.findPairs(state, pairs);
+
+        int found = 0;
+        for (BallPair& pair : pairs) {
+            float dx = state.x[pair.i] - state.x[pair.j];
+            float dy = state.y[pair.i] - state.y[pair.j];
+            float minDist = state.radius[pair.i] + state.radius[pair.j];
+            if (dx*dx + dy*dy <= minDist*minDist) found++;
+        }
+        contacts = found;
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+}
+
+int main(int argc, char* argv[]) {
+    int maxBalls = argc > 1 ? std::atoi(argv[1]) : 8192;
+    std::mt19937 rng(42);
+
+    std::cout << std::setw(8) << "balls" << std::setw(16) << "brute (ns)" << std::setw(16) << "grid (ns)"
+              << std::setw(10) << "speedup" << std::setw(10) << "contacts" << std::endl;
+
+    int crossover = -1;
+    for (int count = 2; count <= maxBalls; count *= 2) {
+        BallState state;
+        float maxX, maxY;
+        scatterBalls(state, count, maxX, maxY, rng);
+
+        BruteForceBroadphase brute;
+        GridBroadphase grid(maxX, maxY, 2.0f * BENCH_RADIUS);
+
+        // Keep roughly the same amount of work per measurement
+        int iterations = glm::max(4, 4000000 / (count * count));
+        int bruteContacts, gridContacts;
+        double bruteTime = timeBroadphase(brute, state, iterations, bruteContacts);
+        double gridTime = timeBroadphase(grid, state, iterations, gridContacts);
+
+        if (bruteContacts != gridContacts) {
+            std::cerr << "Contact mismatch for " << count << " balls : " << bruteContacts << " != " << gridContacts << std::endl;
+            return 1;
+        }
+        if (crossover < 0 && gridTime < bruteTime) crossover = count;
+
+        std::cout << std::setw(8) << count << std::setw(16) << std::fixed << std::setprecision(0) << bruteTime
+                  << std::setw(16) << gridTime << std::setw(10) << std::setprecision(2) << bruteTime / gridTime
+                  << std::setw(10) << gridContacts << std::endl;
+    }
+
+    if (crossover > 0)
+        std::cout << "Grid broadphase is faster from " << crossover << " balls" << std::endl;
+    else
+        std::cout << "Grid broadphase never faster up to " << maxBalls << " balls" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,353 @@
+// Cost of the physics step on reproducible scenarios :
+//   break      : standard rack and a full force break, until all the balls are at rest
+//   scatter    : 16 balls at random positions with random velocities, until at rest
+//   stress_N   : sandbox of N balls (see PoolSimulation::setupSandbox), fixed number of steps
+// Reports ns per step, steps to rest and pair tests per second (narrow phase), as a
+// table or as JSON with --json to track the results over time.
+// With --precision, validates the precisions instead : the break in deterministic steps
+// with float, double and Fixed32 balls, and the distance of the float and Fixed32 balls
+// to the double ones (the reference), with the final state hash of each.
+// With --check, checks that the broadphase and the threads do not change the physics :
+// deterministic steps with the grid broadphase, with the brute-force one, and with the
+// contact islands solved on a thread pool must give the same state hash after every step.
+// Exits with 1 on a difference.
+//
+// usage : bench_physics [--json] [--precision] [--check] [repetitions]
+
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+
+#include "pool_simulation.h"
+#include "thread_pool.h"
+
+const int MAX_STEPS = 20000;          // About 40 s of simulation at 480 Hz
+const int STRESS_STEPS = 2000;
+const int STRESS_COUNTS[] = {64, 256, 1024, 4096};
+const int CHECK_STEPS = 3000;         // The break is at rest after about 2700 steps
+const int CHECK_SANDBOX_STEPS = 500;  // The brute-force broadphase is quadratic
+const int CHECK_BALLS = 512;
+const int CHECK_THREADS = 4;
+
+
+struct ScenarioResult {
+    std::string name;
+    int balls;
+    int steps;
+    bool atRest;
+    long pairTests;
+    double seconds;
+
+    double nsPerStep() const {
+        return seconds * 1e9 / steps;
+    }
+
+    double pairTestsPerSecond() const {
+        return pairTests / seconds;
+    }
+};
+
+// Step until all the balls sleep or maxSteps, and measure
+ScenarioResult run(const std::string& name, PoolSimulation& simulation, int maxSteps) {
+    ScenarioResult result = {name, simulation.balls.size(), 0, false, 0, 0.0};
+
+    auto start = std::chrono::steady_clock::now();
+    while (result.steps < maxSteps && !simulation.balls.allSleeping()) {
+        simulation.step(simulation.timeStep);
+        result.pairTests += (long)simulation.scratch.pairs.size();
+        result.steps++;
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    result.seconds = std::chrono::duration<double>(end - start).count();
+    result.atRest = simulation.balls.allSleeping();
+    return result;
+}
+
+ScenarioResult breakShot() {
+    PoolSimulation simulation;
+    impulseBall(simulation.balls, 0, FORCE_MAX, -90.0f);
+    return run("break", simulation, MAX_STEPS);
+}
+
+// Random positions on a grid of the size of a ball, so that no ball overlaps another
+void scatter(PoolSimulation& simulation, int count, float speed, std::mt19937& rng) {
+    float cell = 2.0f * RADIUS + 0.1f;
+    int cellsX = (int)(2.0f * simulation.maxX / cell);
+    int cellsY = (int)(2.0f * simulation.maxY / cell);
+
+    std::vector<int> cells(cellsX * cellsY);
+    for (int c = 0; c < (int)cells.size(); c++) {
+        cells[c] = c;
+    }
+    std::shuffle(cells.begin(), cells.end(), rng);
+
+    std::uniform_real_distribution<float> randSpeed(-speed, speed);
+    simulation.balls = BallState();
+    for (int i = 0; i < count && i < (int)cells.size(); i++) {
+        int index = simulation.balls.add(RADIUS, MASS);
+        float x = -simulation.maxX + cell * (cells[i] % cellsX + 0.5f);
+        float y = -simulation.maxY + cell * (cells[i] / cellsX + 0.5f);
+        simulation.balls.reset(index, x, y);
+        simulation.balls.vx[index] = randSpeed(rng);
+        simulation.balls.vy[index] = randSpeed(rng);
+    }
+}
+
+ScenarioResult randomScatter() {
+    std::mt19937 rng(42);
+    PoolSimulation simulation;
+    scatter(simulation, BALL_COUNT, 150.0f, rng);
+    return run("scatter", simulation, MAX_STEPS);
+}
+
+ScenarioResult stress(int count) {
+    PoolSimulation simulation;
+    simulation.setupSandbox(count, count);
+    return run("stress_" + std::to_string(count), simulation, STRESS_STEPS);
+}
+
+// Repeat a scenario and keep the run with the median time
+template<typename F>
+ScenarioResult median(int repetitions, F scenario) {
+    std::vector<ScenarioResult> results;
+    for (int r = 0; r < repetitions; r++) {
+        results.push_back(scenario());
+    }
+    std::sort(results.begin(), results.end(), [](const ScenarioResult& a, const ScenarioResult& b) {
+        return a.seconds < b.seconds;
+    });
+    return results[results.size() / 2];
+}
+
+void printTable(const std::vector<ScenarioResult>& results) {
+    std::cout << std::setw(12) << "scenario" << std::setw(8) << "balls" << std::setw(10) << "steps"
+              << std::setw(9) << "at rest" << std::setw(12) << "ns/step" << std::setw(18) << "pair tests/s" << std::endl;
+
+    for (const ScenarioResult& result : results) {
+        std::cout << std::setw(12) << result.name << std::setw(8) << result.balls << std::setw(10) << result.steps
+                  << std::setw(9) << (result.atRest ? "yes" : "no") << std::setw(12) << std::fixed << std::setprecision(0) << result.nsPerStep()
+                  << std::setw(18) << result.pairTestsPerSecond() << std::endl;
+    }
+}
+
+void printJson(const std::vector<ScenarioResult>& results) {
+    std::cout << "{" << std::endl << "  \"benchmark\": \"bench_physics\"," << std::endl;
+    std::cout << "  \"time_step\": " << FIXED_TIME_STEP << "," << std::endl;
+    std::cout << "  \"scenarios\": [" << std::endl;
+
+    for (int r = 0; r < (int)results.size(); r++) {
+        const ScenarioResult& result = results[r];
+        std::cout << "    {\"name\": \"" << result.name << "\", \"balls\": " << result.balls
+                  << ", \"steps\": " << result.steps
+                  << ", \"at_rest\": " << (result.atRest ? "true" : "false")
+                  << std::fixed << std::setprecision(1)
+                  << ", \"ns_per_step\": " << result.nsPerStep()
+                  << ", \"pair_tests\": " << result.pairTests
+                  << ", \"pair_tests_per_second\": " << result.pairTestsPerSecond() << "}"
+                  << (r + 1 < (int)results.size() ? "," : "") << std::endl;
+    }
+
+    std::cout << "  ]" << std::endl << "}" << std::endl;
+}
+
+struct PrecisionRun {
+    std::string name;
+    int steps;
+    bool atRest;
+    int pocketed;
+    uint64_t hash;
+    std::vector<double> positions;   // x and y of every ball after every step
+};
+
+// The break in deterministic steps with balls of precision Real
+template<typename Real>
+PrecisionRun breakPrecision() {
+    BasicPoolSimulation<Real> simulation;
+    simulation.setDeterministic(true);
+    impulseBall(simulation.balls, 0, FORCE_MAX, -90.0f);
+
+    PrecisionRun run = {Precision<Real>::name(), 0, false, 0, 0, std::vector<double>()};
+    const BasicBallState<Real>& balls = simulation.balls;
+    while (run.steps < MAX_STEPS && !balls.allSleeping()) {
+        simulation.step(simulation.timeStep);
+        run.steps++;
+        for (int i = 0; i < balls.size(); i++) {
+            run.positions.push_back(toDouble(balls.x[i]));
+            run.positions.push_back(toDouble(balls.y[i]));
+        }
+    }
+
+    run.atRest = balls.allSleeping();
+    for (int i = 0; i < balls.size(); i++) {
+        if (balls.inPocket(i)) run.pocketed++;
+    }
+    run.hash = simulation.stateHash;
+    return run;
+}
+
+// Largest distance of a ball to the same ball of the reference, after the step s.
+// A run at rest keeps its last positions
+double divergence(const PrecisionRun& run, const PrecisionRun& reference, int s) {
+    size_t balls = run.positions.size() / (2 * glm::max(1, run.steps));
+    size_t a = 2 * balls * glm::min(s, run.steps - 1);
+    size_t b = 2 * balls * glm::min(s, reference.steps - 1);
+
+    double distance = 0.0;
+    for (size_t i = 0; i < 2 * balls; i += 2) {
+        double dx = run.positions[a + i] - reference.positions[b + i];
+        double dy = run.positions[a + i + 1] - reference.positions[b + i + 1];
+        distance = glm::max(distance, std::sqrt(dx * dx + dy * dy));
+    }
+    return distance;
+}
+
+void printPrecisions() {
+    PrecisionRun reference = breakPrecision<double>();
+    std::vector<PrecisionRun> runs;
+    runs.push_back(breakPrecision<float>());
+    runs.push_back(reference);
+    runs.push_back(breakPrecision<Fixed32>());
+
+    std::cout << "Break in deterministic steps, distances to the double balls in table units" << std::endl;
+    std::cout << std::setw(10) << "precision" << std::setw(8) << "steps" << std::setw(9) << "at rest" << std::setw(10) << "pocketed"
+              << std::setw(14) << "max distance" << std::setw(16) << "final distance" << std::setw(20) << "final hash" << std::endl;
+
+    for (const PrecisionRun& run : runs) {
+        double maxDistance = 0.0;
+        int steps = glm::max(run.steps, reference.steps);
+        for (int s = 0; s < steps && run.steps > 0 && reference.steps > 0; s++) {
+            maxDistance = glm::max(maxDistance, divergence(run, reference, s));
+        }
+        double finalDistance = run.steps > 0 && reference.steps > 0 ? divergence(run, reference, steps - 1) : 0.0;
+
+        std::cout << std::setw(10) << run.name << std::setw(8) << run.steps << std::setw(9) << (run.atRest ? "yes" : "no")
+                  << std::setw(10) << run.pocketed << std::setw(14) << std::scientific << std::setprecision(2) << maxDistance
+                  << std::setw(16) << finalDistance << std::setw(20) << std::hex << run.hash << std::dec << std::endl;
+    }
+}
+
+// A table for --check, before its deterministic steps
+typedef std::function<void(PoolSimulation&)> CheckSetup;
+
+struct CheckRun {
+    std::vector<uint64_t> hashes;   // After every step
+    int parallelSteps;              // With enough contacts for the thread pool
+};
+
+// Deterministic steps of the table set up by setup. brute : brute-force broadphase
+// instead of the grid. pool : the contact islands are solved on its workers
+CheckRun checkRun(const CheckSetup& setup, int steps, bool brute, ThreadPool* pool) {
+    PoolSimulation simulation;
+    setup(simulation);
+    if (brute) simulation.scratch.broadphase.reset(new BruteForceBroadphase());
+    simulation.contactPool = pool;
+    simulation.setDeterministic(true);
+
+    CheckRun run = {std::vector<uint64_t>(), 0};
+    simulation.onStep = [&run](uint64_t, uint64_t hash) {
+        run.hashes.push_back(hash);
+    };
+    for (int s = 0; s < steps; s++) {
+        simulation.stepDeterministic();
+
+        int contacts = 0;
+        for (int k = 0; k < simulation.scratch.islands.size(); k++) {
+            contacts += simulation.scratch.islands.islandSize(k);
+        }
+        if (contacts >= PARALLEL_ISLAND_MIN_CONTACTS) run.parallelSteps++;
+    }
+    return run;
+}
+
+// First step where the hashes of run differ from the ones of reference, -1 if none
+int firstDifference(const CheckRun& run, const CheckRun& reference) {
+    for (size_t s = 0; s < run.hashes.size() && s < reference.hashes.size(); s++) {
+        if (run.hashes[s] != reference.hashes[s]) return (int)s + 1;
+    }
+    return run.hashes.size() == reference.hashes.size() ? -1 : (int)glm::min(run.hashes.size(), reference.hashes.size()) + 1;
+}
+
+// CHECK_BALLS balls in rows closer than CONTACT_MARGIN, so that most of them start in contact
+void packedBalls(PoolSimulation& simulation) {
+    simulation.setupSandbox(CHECK_BALLS);
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> randSpeed(-SANDBOX_SPEED, SANDBOX_SPEED);
+    float spacing = 2.0f * RADIUS + 0.5f * CONTACT_MARGIN;
+    int side = (int)glm::ceil(glm::sqrt((float)CHECK_BALLS));
+    for (int i = 0; i < simulation.balls.size(); i++) {
+        simulation.balls.reset(i, spacing * (i % side - 0.5f * side), spacing * (i / side - 0.5f * side));
+        simulation.balls.vx[i] = randSpeed(rng);
+        simulation.balls.vy[i] = randSpeed(rng);
+    }
+}
+
+bool checkBroadphases() {
+    struct CheckScenario {
+        std::string name;
+        int steps;
+        CheckSetup setup;
+    };
+    std::vector<CheckScenario> scenarios = {
+        {"break", CHECK_STEPS, [](PoolSimulation& simulation) { impulseBall(simulation.balls, 0, FORCE_MAX, -90.0f); }},
+        {"stress_" + std::to_string(CHECK_BALLS), CHECK_SANDBOX_STEPS, [](PoolSimulation& simulation) { simulation.setupSandbox(CHECK_BALLS); }},
+        {"packed_" + std::to_string(CHECK_BALLS), CHECK_SANDBOX_STEPS, packedBalls},
+    };
+    ThreadPool pool(CHECK_THREADS);
+
+    std::cout << "Deterministic steps, first step with another state hash than the grid broadphase on one thread" << std::endl;
+    std::cout << std::setw(12) << "scenario" << std::setw(8) << "steps" << std::setw(16) << "parallel steps"
+              << std::setw(14) << "brute force" << std::setw(18) << "parallel islands" << std::endl;
+
+    bool same = true;
+    for (const CheckScenario& scenario : scenarios) {
+        CheckRun grid = checkRun(scenario.setup, scenario.steps, false, nullptr);
+        CheckRun brute = checkRun(scenario.setup, scenario.steps, true, nullptr);
+        CheckRun parallel = checkRun(scenario.setup, scenario.steps, false, &pool);
+
+        int bruteDifference = firstDifference(brute, grid);
+        int parallelDifference = firstDifference(parallel, grid);
+        same = same && bruteDifference < 0 && parallelDifference < 0;
+
+        std::cout << std::setw(12) << scenario.name << std::setw(8) << scenario.steps << std::setw(16) << parallel.parallelSteps
+                  << std::setw(14) << (bruteDifference < 0 ? "same" : std::to_string(bruteDifference))
+                  << std::setw(18) << (parallelDifference < 0 ? "same" : std::to_string(parallelDifference)) << std::endl;
+    }
+    return same;
+}
+
+int main(int argc, char* argv[]) {
+    bool json = false;
+    int repetitions = 5;
+    for (int a = 1; a < argc; a++) {
+        if (std::strcmp(argv[a], "--json") == 0) json = true;
+        else if (std::strcmp(argv[a], "--precision") == 0) {
+            printPrecisions();
+            return 0;
+        }
+        else if (std::strcmp(argv[a], "--check") == 0) {
+            return checkBroadphases() ? 0 : 1;
+        }
+        else repetitions = glm::max(1, std::atoi(argv[a]));
+    }
+
+    std::vector<ScenarioResult> results;
+    results.push_back(median(repetitions, breakShot));
+    results.push_back(median(repetitions, randomScatter));
+    for (int count : STRESS_COUNTS) {
+        results.push_back(median(repetitions, [count] { return stress(count); }));
+    }
+
+    if (json) printJson(results);
+    else printTable(results);
+
+    return 0;
+}
@@ -0,0 +1,81 @@
+// Cost of saving and restoring a table (see table_snapshot.h) in the middle of a break,
+// against the copy of its BallState, and check that a restored table steps to the same
+// states as the original.
+//
+// usage : bench_snapshot [iterations]
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+
+#include "pool_simulation.h"
+
+const int BREAK_STEPS = 240;    // Half a second into the break, most balls moving
+const int CHECK_STEPS = 480;
+
+
+// Operations per second of f over iterations calls
+template<typename F>
+double perSecond(int iterations, F f) {
+    auto start = std::chrono::steady_clock::now();
+    for (int k = 0; k < iterations; k++) {
+        f(k);
+    }
+    auto end = std::chrono::steady_clock::now();
+    return iterations / std::chrono::duration<double>(end - start).count();
+}
+
+int main(int argc, char* argv[]) {
+    int iterations = argc > 1 ? glm::max(1, std::atoi(argv[1])) : 1000000;
+
+    PoolSimulation simulation;
+    simulation.setDeterministic(true);
+    impulseBall(simulation.balls, 0, FORCE_MAX, -90.0f);
+    for (int s = 0; s < BREAK_STEPS; s++) {
+        simulation.step(simulation.timeStep);
+    }
+
+    TableSnapshot snapshot;
+    BallState copy = simulation.balls;
+    volatile float sink = 0.0f;   // Keeps the copies from being optimized out
+
+    double saves = perSecond(iterations, [&](int k) {
+        simulation.saveSnapshot(snapshot);
+        sink = sink + snapshot.values[0][k % SNAPSHOT_MAX_BALLS];
+    });
+    double restores = perSecond(iterations, [&](int k) {
+        simulation.restoreSnapshot(snapshot);
+        sink = sink + simulation.balls.x[k % SNAPSHOT_MAX_BALLS];
+    });
+    double copies = perSecond(iterations, [&](int k) {
+        copy = simulation.balls;
+        sink = sink + copy.x[k % SNAPSHOT_MAX_BALLS];
+    });
+
+    // A restored table must go on exactly as the original
+    simulation.saveSnapshot(snapshot);
+    for (int s = 0; s < CHECK_STEPS; s++) {
+        simulation.step(simulation.timeStep);
+    }
+    uint64_t expected = simulation.stateHash;
+
+    simulation.restoreSnapshot(snapshot);
+    for (int s = 0; s < CHECK_STEPS; s++) {
+        simulation.step(simulation.timeStep);
+    }
+    if (simulation.stateHash != expected) {
+        std::cerr << "Restored table diverged : " << std::hex << simulation.stateHash << " != " << expected << std::endl;
+        return 1;
+    }
+
+    std::cout << "snapshot size : " << sizeof(TableSnapshot) << " bytes" << std::endl;
+    std::cout << std::setw(20) << "operation" << std::setw(16) << "per second" << std::setw(12) << "ns" << std::endl;
+    for (auto row : {std::make_pair("save snapshot", saves), std::make_pair("restore snapshot", restores),
+                     std::make_pair("copy BallState", copies)}) {
+        std::cout << std::setw(20) << row.first << std::setw(16) << std::fixed << std::setprecision(0) << row.second
+                  << std::setw(12) << std::setprecision(1) << 1e9 / row.second << std::endl;
+    }
+
+    return 0;
+}
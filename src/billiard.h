@@ -4,9 +4,12 @@
 // Some parts of the code were taken from https://learnopengl.com/
 
 #include <iostream>
+#include <fstream>
 #include <sstream>
 #include <iomanip>
 #include <vector>
+#include <memory>
+#include <chrono>
 
 
 #include <glad/glad.h>
@@ -14,19 +17,31 @@
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
 
 
 #include "texture.h"
 #include "mesh.h"
 #include "entity.h"
 #include "ball.h"
+#include "ball_transforms.h"
 #include "cue.h"
+#include "aim_line.h"
+#include "physics/pool_simulation.h"
+#include "physics/shot_planner.h"
+#include "physics/replay.h"
+#include "physics/simulation_thread.h"
+#include "physics/aim_predictor.h"
+#include "physics/rollback_peer.h"
 
 
 
 const glm::vec3 TABLE_DIM = glm::vec3(1.92f, 0.986f, 0.96f);
-const glm::vec3 COORD_RES = glm::vec3(200.0f, 100.0f, 100.0f);
+const char* const SANDBOX_BALL_TEXTURE = "09";   // Shared by all the balls of a sandbox
 
+// Renders the pool table, the balls and the cue of a PoolSimulation running on a
+// SimulationThread : the input is sent as commands, and the transforms are computed
+// from the latest frame the thread published
 class PoolGame 
 {
 public:
@@ -37,129 +52,500 @@ public:
     Entity table;
     PoolCue cue;
     std::vector<PoolBall> balls;
-    std::vector<PoolPocket> pockets;
-
+    BallTransforms ballTransforms;
+    BallMatrixBuffer ballMatrices;
+
+    // Predicted path of the shot while aiming, created with the ball textures
+    AimPredictor aimPredictor;
+    std::unique_ptr<AimLine> aimLine;
+
+    // Created on first use, used on the simulation thread
+    std::unique_ptr<ShotPlanner> planner;
+    std::unique_ptr<ShotCache> shotCache;
+
+    // Replays
+    std::unique_ptr<ReplayRecorder> recorder;
+    std::unique_ptr<ReplayPlayer> player;
+    std::unique_ptr<ReplayChecker> checker;   // Playback of a checked replay
+    ReplayFrame replayFrame;
+    double replayTime = 0.0;   // Game time not yet played from the replay
+
+    // Deterministic simulation : the replays are checked. A recording starts once the
+    // simulation thread took the snapshot of the table, with the inputs logged after it
+    bool deterministic = false;
+    uint64_t inputsRead = 0;           // Inputs taken from the log of the simulation thread
+    uint64_t pendingRecord = 0;        // Command that takes the snapshot (0 : none)
+    std::string pendingRecordPath;
+    ReplayStart recordStart;           // Written by the command
+    bool recordStartValid = false;
+    uint64_t recordInputStart = 0;
+    uint64_t recordInputsLost = 0;
+
+    // Physics counters written to a CSV file, one row per frame
+    std::unique_ptr<std::ofstream> statsFile;
+    PhysicsStatsSnapshot statsStart;   // When the dump started
+    PhysicsStatsSnapshot statsLast;    // Last row
+    std::chrono::steady_clock::time_point statsStartTime;
+
+    // Versus : rollback match of versusPlayer (0 or 1, -1 : none) against the other player
+    // on the loopback interface. Only the cue inputs reach the table, the commands that
+    // change it otherwise are ignored. The peer is used on the simulation thread
+    int versusPlayer = -1;
+    std::unique_ptr<RollbackPeer> versus;
+    CueInput heldCue;       // Directions held during this frame
+    CueInput heldCueSent;   // Last ones sent to the peer
+
+    // Last member : the thread is stopped before the planner it may use is destroyed
+    std::unique_ptr<SimulationThread> simulation;
+    // Command that placed balls, their views are reset once its frame arrives (0 : none)
+    uint64_t pendingReset = 0;
+    bool pendingResetAll = false;   // All the balls, or only the cue ball
+
+    // Sandbox : no cue, fixed-step physics only, and the table is drawn tableScale times smaller than simulated
+    bool sandbox = false;
+    float tableScale = 1.0f;
 
     PoolGame(
         const char* tableMeshPath,
         const char* tableTexturePath,
         const char* ballMeshPath,
-        std::string ballTexturePath
+        std::string ballTexturePath,
+        int ballCount = BALL_COUNT,
+        int versusPlayer = -1,
+        bool deterministic = false
         ) : 
         tableMesh(tableMeshPath), table(tableMesh, Texture(tableTexturePath)), ballMesh(ballMeshPath),
-        cue(cueMesh, Texture(PATH_TO_TEXTURE "/pool_table/cue_colormap.jpg"))
+        cue(cueMesh, Texture(PATH_TO_TEXTURE "/pool_table/cue_colormap.jpg")),
+        versusPlayer(ballCount == BALL_COUNT ? versusPlayer : -1),
+        deterministic(deterministic && this->versusPlayer < 0)
          {
-        
-        for (int i = 0; i < 16; i++) {
-            std::stringstream ss;
-            ss << std::setw(2) << std::setfill('0') << i;
-            Texture texture = Texture((ballTexturePath + "ball_" + ss.str() + ".jpg").c_str());
-            balls.push_back(PoolBall(ballMesh, texture));
+
+        simulation.reset(new SimulationThread(ballCount));
+        if (this->deterministic) {
+            simulation->post([](PoolSimulation& sim) {
+                sim.setDeterministic(true);
+            });
+            std::cout << "Deterministic simulation, the replays are checked" << std::endl;
+        }
+        const TableFrame& frame = simulation->latest();
+        sandbox = ballCount != BALL_COUNT;
+        tableScale = frame.maxY / (COORD_RES.x * 0.5f);
+
+        balls.reserve(frame.size());
+        if (sandbox) {
+            // All the balls share the mesh and one texture
+            Texture texture = Texture((ballTexturePath + "ball_" + SANDBOX_BALL_TEXTURE + ".jpg").c_str());
+            for (int i = 0; i < frame.size(); i++) {
+                balls.push_back(PoolBall(ballMesh, texture, i));
+            }
+            std::cout << "Sandbox of " << frame.size() << " balls, table scaled by " << tableScale << std::endl;
+        }
+        else {
+            for (int i = 0; i < frame.size(); i++) {
+                std::stringstream ss;
+                ss << std::setw(2) << std::setfill('0') << i;
+                Texture texture = Texture((ballTexturePath + "ball_" + ss.str() + ".jpg").c_str());
+                balls.push_back(PoolBall(ballMesh, texture, i));
+            }
         }
+        aimLine.reset(new AimLine(ballMesh, balls.at(0).textures[0]));
 
-        setupPockets();
-        resetGame();
+        if (this->versusPlayer >= 0) startVersus();
     }
 
     void update(double deltaTime) {
+        if (versusPlayer >= 0) holdCue();
+
+        const TableFrame& frame = simulation->latest();
+        if (pendingRecord && frame.commands >= pendingRecord) {
+            pendingRecord = 0;
+            startRecording(frame);
+        }
+        readInputs(frame);
+
+        if (player) {
+            aimLine->visible = false;
+            updateReplay(deltaTime);
+            return;
+        }
+
+        if (pendingReset && frame.commands >= pendingReset) {
+            resetBallViews(pendingResetAll);
+            pendingReset = 0;
+        }
+
+        float alpha = frame.alphaAt(std::chrono::steady_clock::now());
         for (PoolBall& ball : balls) {
-            ball.update(deltaTime);
+            if (ball.restingTransform && frame.sleeping(ball.index)) continue;
+            ball.interpolate(frame, alpha);
         }
-        
-        for (int i = 0; i < balls.size(); i++) {
-            PoolBall& ball = balls.at(i);
+        buildBallTransforms();
+        cue.computeTransform(frame.cue, table.transform, TABLE_DIM, COORD_RES);
+        updateAimLine(frame);
+
+        if (recorder) recordFrame(frame, (float)deltaTime);
+        if (statsFile) dumpStats();
+    }
 
-            for (int j = i+1; j < balls.size(); j++) {
-                if (ball.checkCollision(balls.at(j))) {
-                    ball.handleCollision(balls.at(j));
-                }
+    void switchRecording(const std::string& path) {
+        if (recorder) {
+            recorder->stop();
+            std::cout << std::endl << "Replay saved : " << recorder->framesWritten << " frames, "
+                      << std::fixed << std::setprecision(0) << recorder->bytesPerSecond() << " bytes/s" << std::endl;
+            if (simulation->latest().inputsLost != recordInputsLost) {
+                std::cout << "Inputs were lost during the recording, the replay will not check" << std::endl;
             }
+            recorder.reset();
+            return;
+        }
+        if (pendingRecord) return;
+
+        pendingRecordPath = path;
+        if (!deterministic) {
+            recordStartValid = false;
+            startRecording(simulation->latest());
+            return;
+        }
+
+        // Snapshot of the table between two ticks, and the number of the inputs before it
+        pendingRecord = simulation->post([this](PoolSimulation& sim) {
+            recordStartValid = sim.deterministic && sim.saveSnapshot(recordStart.snapshot);
+            recordStart.phaseMotion = sim.phaseMotion;
+            recordInputStart = simulation->inputCount();
+        });
+    }
+
+    void switchStatsDump(const std::string& path) {
+        if (statsFile) {
+            PhysicsStatsSnapshot total = simulation->stats().snapshot() - statsStart;
+            double perStep = total.steps ? total.totalNanoseconds() * 1e-3 / total.steps : 0.0;
+            std::cout << std::endl << "Physics stats saved : " << total.steps << " steps, " << total.contacts << " contacts, "
+                      << total.railHits << " rail hits, " << std::fixed << std::setprecision(2) << perStep << " us/step" << std::endl;
+            statsFile.reset();
+            return;
+        }
 
-            ball.checkTable(pockets, COORD_RES.z * 0.5f, COORD_RES.x * 0.5f);
-            ball.computeTransform(table.transform, TABLE_DIM, COORD_RES);
+        if (!PhysicsStats::enabled) {
+            std::cout << std::endl << "Physics stats are disabled in this build" << std::endl;
+            return;
         }
 
-        if (cue.update(deltaTime, balls.at(0).Position)) {
-            balls.at(0).impulse(cue.force, cue.azimuthal);
+        statsFile.reset(new std::ofstream(path));
+        if (!*statsFile) {
+            std::cout << std::endl << "Cannot write the physics stats " << path << std::endl;
+            statsFile.reset();
+            return;
+        }
+        PhysicsStatsSnapshot::writeCsvHeader(*statsFile);
+        statsStart = statsLast = simulation->stats().snapshot();
+        statsStartTime = std::chrono::steady_clock::now();
+        std::cout << std::endl << "Writing physics stats to " << path << std::endl;
+    }
+
+    // Work of the physics since the last frame
+    void dumpStats() {
+        PhysicsStatsSnapshot stats = simulation->stats().snapshot();
+        double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - statsStartTime).count();
+        (stats - statsLast).writeCsvRow(*statsFile, time);
+        statsLast = stats;
+    }
+
+    void switchPlayback(const std::string& path) {
+        if (versusPlayer >= 0) return;
+        if (player) {
+            stopPlayback();
+            return;
+        }
+
+        player.reset(new ReplayPlayer());
+        if (!player->open(path) || player->ballCount() != (int)balls.size()) {
+            std::cout << std::endl << "Cannot play the replay " << path << std::endl;
+            player.reset();
+            return;
+        }
+        replayTime = 0.0;
+        simulation->setPaused(true);
+        std::cout << std::endl << "Playing " << path << std::endl;
+
+        if (player->start()) {
+            checker.reset(new ReplayChecker(*player->start(), (int)balls.size()));
+            if (!checker->valid()) checker.reset();
         }
-        cue.computeTransform(table.transform, TABLE_DIM, COORD_RES);
     }
 
     void resetCueBall() {
-        balls.at(0).reset(0.0f, COORD_RES.x * 0.25f);
+        if (versusPlayer >= 0) return;
+        resetViewsAfter(simulation->postInput(TableInput(TABLE_RESET_CUE_BALL)), false);
     }
 
     void draw(Shader& shader) {
         cue.draw(shader);
+        aimLine->draw(shader);
+        ballMatrices.bind();
         for (PoolBall& ball : balls) {
-            ball.draw(shader);
+            shader.setInteger("u_ball", ball.index + 1);
+            ball.drawMesh(shader);
         }
+        shader.setInteger("u_ball", 0);
         table.draw(shader);
     }
 
     void resetGame() {
-        setupBalls();
+        if (versusPlayer >= 0) return;
+        resetViewsAfter(simulation->postInput(TableInput(TABLE_RESET_GAME)), true);
     }
 
     void turnCue(int direction, float deltaTime) {
-        cue.turn(direction, deltaTime);
+        if (versusPlayer >= 0) {
+            heldCue.turn = (int8_t)(direction >= 0 ? 1 : -1);
+            return;
+        }
+        simulation->postInput(TableInput(TABLE_TURN_CUE, (float)direction, deltaTime));
     }
     
     void moveCue(int direction, float deltaTime) {
-        cue.changeDistance(direction, deltaTime);
+        if (versusPlayer >= 0) {
+            heldCue.move = (int8_t)(direction >= 0 ? 1 : -1);
+            return;
+        }
+        simulation->postInput(TableInput(TABLE_MOVE_CUE, (float)direction, deltaTime));
     }
 
     void shootCue() {
-        cue.shoot();
+        if (versusPlayer >= 0) {
+            pressCue(CueInput{0, 0, CUE_SHOOT});
+            return;
+        }
+        simulation->postInput(TableInput(TABLE_SHOOT_CUE));
     }
 
     void switchCueState() {
-        cue.switchEnable();
+        if (sandbox || versusPlayer >= 0) return;
+        simulation->postInput(TableInput(TABLE_SWITCH_CUE));
+    }
+
+    // Aim the cue at the shot most likely to pocket a ball.
+    // The search runs on the simulation thread, where the table is at rest
+    void suggestShot() {
+        if (versusPlayer >= 0) return;
+        simulation->post([this](PoolSimulation& sim) {
+            planShot(sim);
+        });
+    }
+
+    // Not in a sandbox : the event-driven engine predicts every pair of balls
+    void switchPhysicsMode() {
+        if (sandbox || versusPlayer >= 0) return;
+        simulation->post([](PoolSimulation& sim) {
+            sim.switchPhysicsMode();
+            std::cout << std::endl << (sim.eventDriven ? "Event-driven physics" : "Fixed-step physics") << std::endl;
+        });
+    }
+
+    void switchMotionModel() {
+        if (versusPlayer >= 0) return;
+        simulation->post([this](PoolSimulation& sim) {
+            simulation->applyInput(TableInput(TABLE_SWITCH_MOTION_MODEL));
+            // The outcomes cached by the planner were played with the other model
+            if (shotCache) shotCache->clear();
+            std::cout << std::endl << (sim.phaseMotion ? "Sliding, rolling and spinning balls" : "Velocity friction balls") << std::endl;
+        });
+    }
+
+    // Rollbacks of the versus match so far
+    void printVersusStats() {
+        if (versusPlayer < 0) return;
+        simulation->post([this](PoolSimulation&) {
+            const RollbackStats& stats = versus->session.stats;
+            std::cout << std::endl << "Rollbacks : " << stats.ticks << " frames, " << stats.rollbacks << " rollbacks of "
+                      << std::fixed << std::setprecision(1) << (stats.rollbacks ? (double)stats.resimulatedTicks / stats.rollbacks : 0.0)
+                      << " frames on average (" << stats.maxRollback << " max), " << std::setprecision(2) << stats.rollbackMicrosecondsPerTick()
+                      << " us per frame, " << stats.stalls << " stalls, " << stats.desyncs << " desyncs" << std::endl;
+        });
     }
 
 private: 
-    void setupBalls() {
-        if (balls.size() != 16) return;
-
-        // Place balls in triangle
-        const float maxX = COORD_RES.x * 0.5f;
-        const float r = RADIUS + 0.1f;
-        const float h = glm::sqrt(3) * r;
-        int indexes[15]  = {9, 7, 12, 15, 8, 1, 6, 10, 3, 14, 11, 2, 13, 4, 5};
-        int length = 1;
-        int number = 1;
-        
-        resetCueBall();
-        glm::vec3 current = glm::vec3(0.0f, -maxX * 0.5f, 0.0f);
-        
-        for (int i=0; i<15; i++) {
-            int index = indexes[i];
-
-            if (number < length) {
-                balls[index].reset(current.x, current.y);
-                current.x = current.x + r*2;
-                number++;
+    void startVersus() {
+        resetViewsAfter(simulation->post([this](PoolSimulation& sim) {
+            versus.reset(new RollbackPeer(sim, versusPlayer));
+            if (!versus->connected()) {
+                std::cout << std::endl << "Cannot listen on port " << ROLLBACK_PORT + versusPlayer << std::endl;
+                return;
             }
-            else {
-                balls[index].reset(current.x, current.y);
-                current.y = current.y - h;
-                current.x = current.x - r*(2*length-1);
+            std::cout << std::endl << "Versus : player " << versusPlayer << ", the other player on port "
+                      << ROLLBACK_PORT + versus->session.remotePlayer() << std::endl;
+            printTurn();
+        }), true);
+
+        simulation->setDriver([this](PoolSimulation&, double deltaTime) {
+            int active = versus->session.match().activePlayer;
+            versus->update(deltaTime);
+            if (versus->session.match().activePlayer != active) printTurn();
+            return 1.0f;
+        });
+    }
 
-                length++;
-                number = 1;
+    // Simulation thread
+    void printTurn() {
+        bool local = versus->session.match().activePlayer == versusPlayer;
+        std::cout << std::endl << (local ? "Your turn" : "Turn of the other player") << std::endl;
+    }
+
+    void pressCue(CueInput input) {
+        simulation->post([this, input](PoolSimulation&) {
+            versus->press(input);
+        });
+    }
+
+    // The directions held during the last frame go to the peer when they change (a
+    // released key included), its ticks take them until then
+    void holdCue() {
+        if (heldCue != heldCueSent) {
+            CueInput input = heldCue;
+            bool posted = simulation->post([this, input](PoolSimulation&) {
+                versus->hold(input);
+            }) != 0;
+            if (posted) heldCueSent = heldCue;
+        }
+        heldCue = CueInput();
+    }
+
+    void planShot(PoolSimulation& sim) {
+        if (!sim.cue.enabled || !sim.cue.takeInput || !sim.balls.allSleeping()) return;
+
+        if (!planner) {
+            ShotPlannerSettings settings;
+            settings.timeBudget = 0.25;
+            planner.reset(new ShotPlanner(settings));
+            shotCache.reset(new ShotCache());
+            planner->cache = shotCache.get();
+        }
+
+        std::vector<PlannedShot> shots = planner->plan(sim);
+        if (shots.empty()) return;
+
+        const PlannedShot& best = shots.front();
+        simulation->applyInput(TableInput(TABLE_AIM_CUE, best.azimuthal, best.force));
+        std::cout << std::endl << "Suggested shot : angle " << std::fixed << std::setprecision(1) << best.azimuthal
+                  << ", force " << best.force << ", pocketing " << std::setprecision(0) << 100.0f * best.pocketProbability
+                  << "% (" << planner->samplesPlayed() << " samples, " << 100.0 * shotCache->hitRate() << "% cached)" << std::endl;
+    }
+
+    void buildBallTransforms() {
+        ballTransforms.setTable(table.transform, TABLE_DIM, COORD_RES, tableScale);
+        if (ballTransforms.build(balls)) ballMatrices.upload(ballTransforms);
+    }
+
+    // Only computed again when the cue turns, its force changes or the balls moved
+    void updateAimLine(const TableFrame& frame) {
+        aimLine->visible = frame.cue.enabled && frame.cue.takeInput && frame.allSleeping();
+        if (!aimLine->visible) return;
+
+        if (aimPredictor.update(frame, frame.pockets, frame.maxX, frame.maxY, frame.cue.azimuthal, frame.cue.shotForce())) {
+            aimLine->computeTransforms(aimPredictor.prediction, table.transform, TABLE_DIM, COORD_RES);
+        }
+    }
+
+    // Inputs of the log up to the frame, kept for the replay while recording
+    void readInputs(const TableFrame& frame) {
+        TableInput input;
+        while (inputsRead < frame.inputs && simulation->nextInput(input)) {
+            if (recorder && inputsRead >= recordInputStart) replayFrame.inputs.push_back(input);
+            inputsRead++;
+        }
+    }
+
+    void startRecording(const TableFrame& frame) {
+        recorder.reset(new ReplayRecorder(pendingRecordPath, (int)balls.size(), recordStartValid ? &recordStart : nullptr));
+        if (!recorder->isOpen()) {
+            std::cout << std::endl << "Cannot write the replay " << pendingRecordPath << std::endl;
+            recorder.reset();
+            return;
+        }
+        replayFrame.inputs.clear();
+        recordInputsLost = frame.inputsLost;
+        std::cout << std::endl << "Recording to " << pendingRecordPath << (recordStartValid ? ", checked" : "") << std::endl;
+    }
+
+    void recordFrame(const TableFrame& frame, float deltaTime) {
+        replayFrame.deltaTime = deltaTime;
+        replayFrame.balls.resize(balls.size());
+        for (PoolBall& ball : balls) {
+            ReplayBall& replayBall = replayFrame.balls[ball.index];
+            // As shown : both interpolated between the two last steps
+            replayBall.position = ball.Position;
+            replayBall.rotation = ball.Rotation;
+            replayBall.flags = frame.flags[ball.index];
+        }
+
+        const CueState& cueState = frame.cue;
+        replayFrame.cue = {cueState.Position, cueState.azimuthal, cueState.distance, cueState.enabled};
+        replayFrame.stepCount = frame.stepCount;
+        replayFrame.stateHash = frame.stateHash;
+        recorder->record(replayFrame);
+        replayFrame.inputs.clear();
+    }
+
+    // Show the frames of the replay at the speed they were recorded
+    void updateReplay(double deltaTime) {
+        replayTime += deltaTime;
+        bool shown = false;
+
+        while (replayTime > 0.0) {
+            if (!player->next(replayFrame)) {
+                stopPlayback();
+                return;
             }
-            
-            balls[index].Rotation = glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+            replayTime -= replayFrame.deltaTime;
+            if (checker) checker->check(replayFrame);
+            shown = true;
+        }
+        if (!shown) return;
+
+        for (PoolBall& ball : balls) {
+            const ReplayBall& replayBall = replayFrame.balls[ball.index];
+            ball.place(replayBall.position, replayBall.rotation);
         }
+        buildBallTransforms();
+
+        CueState cueState;
+        cueState.Position = replayFrame.cue.position;
+        cueState.azimuthal = replayFrame.cue.azimuthal;
+        cueState.distance = replayFrame.cue.distance;
+        cueState.enabled = replayFrame.cue.enabled;
+        cue.computeTransform(cueState, table.transform, TABLE_DIM, COORD_RES);
     }
 
-    void setupPockets() {
-        pockets.push_back(PoolPocket(-POCKET_X, 0.0f, 0.0f));
-        pockets.push_back(PoolPocket(-POCKET_X2, -POCKET_Y, 45.0f));
-        pockets.push_back(PoolPocket(POCKET_X2, -POCKET_Y, 135.0f));
-        pockets.push_back(PoolPocket(POCKET_X, 0.0f, 180.0f));
-        pockets.push_back(PoolPocket(POCKET_X2, POCKET_Y, -135.0f));
-        pockets.push_back(PoolPocket(-POCKET_X2, POCKET_Y, -45.0f));
+    void stopPlayback() {
+        std::cout << std::endl << "Replay : " << player->framesDecoded << " frames, " << std::fixed << std::setprecision(0)
+                  << player->bytesPerSecond() << " bytes/s, decoded at " << player->framesPerSecondDecoded() << " frames/s" << std::endl;
+        if (checker) {
+            std::cout << "Replay check : " << checker->keyframesChecked << " keyframes, " << checker->mismatches << " mismatches";
+            if (checker->mismatches) std::cout << " from step " << checker->firstMismatch;
+            std::cout << std::endl;
+        }
+        checker.reset();
+        player.reset();
+        simulation->setPaused(false);
+
+        // Back to the simulation
+        for (PoolBall& ball : balls) {
+            ball.restingTransform = false;
+        }
+    }
+
+    // command : number of the posted command that places the balls (0 if it was not queued)
+    void resetViewsAfter(uint64_t command, bool all) {
+        if (!command) return;
+        pendingResetAll = all || (pendingReset && pendingResetAll);
+        pendingReset = command;
+    }
+
+    void resetBallViews(bool all) {
+        for (PoolBall& ball : balls) {
+            if (!all && ball.index != 0) continue;
+            ball.reset();
+        }
     }
 };
 
@@ -37,6 +37,18 @@ public:
     }
 
     void draw(Shader& shader) {
+        draw(shader, transform, glm::transpose(glm::inverse(transform)));
+    }
+
+    // With the model matrix M and the normal matrix itM (inverse transpose of M) computed by the caller
+    void draw(Shader& shader, const glm::mat4& M, const glm::mat4& itM) {
+        shader.setMatrix4("M", M);
+		shader.setMatrix4("itM", itM);
+        drawMesh(shader);
+	}
+
+    // With the matrices already known by the shader (see BallMatrixBuffer)
+    void drawMesh(Shader& shader) {
         if (!model) return;
         bool useNormalMap = false;
 
@@ -56,8 +68,6 @@ public:
             }
         }
 
-        shader.setMatrix4("M", transform);
-		shader.setMatrix4("itM", glm::transpose(glm::inverse(transform)));
 		model->draw();
         
         if (useNormalMap) {
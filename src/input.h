@@ -41,6 +41,14 @@ public:
 	bool enabledLights = true;
 	bool lightsPressed = false;
 
+	bool physicsModePressed = false;
+	bool suggestShotPressed = false;
+	bool recordPressed = false;
+	bool playbackPressed = false;
+	bool statsPressed = false;
+	bool motionModelPressed = false;
+	bool versusStatsPressed = false;
+
 	GLuint controlsVAO;
 	GLuint controlsTex;
 
@@ -149,6 +157,32 @@ public:
 		// Shoot with SPACE
 		if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS)
 			poolGame->shootCue();
+
+		// Switch between fixed-step and event-driven physics with F2
+		if (wasKeyPressed(window, GLFW_KEY_F2, physicsModePressed))
+			poolGame->switchPhysicsMode();
+
+		// Aim the cue at the best shot found by the planner with F3
+		if (wasKeyPressed(window, GLFW_KEY_F3, suggestShotPressed))
+			poolGame->suggestShot();
+
+		// Record the game with F5, play the last recording with F6
+		if (wasKeyPressed(window, GLFW_KEY_F5, recordPressed))
+			poolGame->switchRecording("replay.bin");
+		if (wasKeyPressed(window, GLFW_KEY_F6, playbackPressed))
+			poolGame->switchPlayback("replay.bin");
+
+		// Write the physics counters of every frame with F7
+		if (wasKeyPressed(window, GLFW_KEY_F7, statsPressed))
+			poolGame->switchStatsDump("physics_stats.csv");
+
+		// Switch the motion of the balls between velocity friction and sliding, rolling and spinning with F8
+		if (wasKeyPressed(window, GLFW_KEY_F8, motionModelPressed))
+			poolGame->switchMotionModel();
+
+		// Print the rollbacks of a versus match with F9
+		if (wasKeyPressed(window, GLFW_KEY_F9, versusStatsPressed))
+			poolGame->printVersusStats();
 	}
 
 	void mouse_callback(GLFWwindow* window, double xpos, double ypos)
@@ -2,6 +2,8 @@
 
 
 #include<iostream>
+#include <cstdlib>
+#include <cstring>
 
 //include glad before GLFW to avoid header conflict or define "#define GLFW_INCLUDE_NONE"
 #include <glad/glad.h>
@@ -163,6 +165,12 @@ int main(int argc, char* argv[])
     multiplelightingShader.setVector3f("materialColour", materialColour);
     multiplelightingShader.setFloat("shininess", 32.0f);
 
+    // The ball matrices have their own texture unit : a sampler left on unit 0 would clash with u_texture
+    for (Shader* shader : {&multiplelightingShader, &windowShader, &mirrorShader, &lampShader, &simpleDepthShader}) {
+        shader->use();
+        shader->setInteger("u_ballMatrices", BALL_MATRIX_UNIT);
+    }
+
 	// Skybox
 	char pathCube[] = PATH_TO_OBJECTS "/cube.obj";
 	std::string pathToCubeMap = PATH_TO_TEXTURE "/cubemaps/yokohama3/";
@@ -176,8 +184,18 @@ int main(int argc, char* argv[])
 	};
 	Skybox skybox(pathToCubeMap, facesToLoad , pathCube);
 
-	// Scene
-	RoomScene room(skybox);
+	// Scene, with a sandbox of N balls when started with N as argument,
+	// or a rollback match as player P against another process with --versus P.
+	// --deterministic : deterministic simulation, the replays are checked on playback
+	int ballCount = BALL_COUNT;
+	int versusPlayer = -1;
+	bool deterministic = false;
+	for (int a = 1; a < argc; a++) {
+		if (std::strcmp(argv[a], "--versus") == 0 && a + 1 < argc) versusPlayer = glm::clamp(std::atoi(argv[++a]), 0, 1);
+		else if (std::strcmp(argv[a], "--deterministic") == 0) deterministic = true;
+		else ballCount = glm::max(1, std::atoi(argv[a]));
+	}
+	RoomScene room(skybox, ballCount, versusPlayer, deterministic);
 
     Camera camera(glm::vec3(-2.0f, 2.5f, 1.0f), glm::vec3(0.0f, 1.0f, 0.0f), -30.0f, -30.0f);
 	glm::mat4 view = camera.GetViewMatrix();
@@ -0,0 +1,235 @@
+#ifndef AIM_PREDICTOR_H
+#define AIM_PREDICTOR_H
+
+// Predicted path of a shot, computed analytically from the balls at rest instead of
+// simulating : the cue ball goes straight, bounces on the rails, until it touches
+// a ball, enters a pocket or stops. At the first contact the object ball leaves along
+// the line of centers and the cue ball along the tangent line, and both are traced the same way.
+//
+// The model is the one of the physics : the speed decreases linearly with the distance
+// travelled (friction proportional to the velocity), the rails reflect the velocity
+// without loss, and a collision of two equal balls gives (1 + RESTITUTION) / 2 of the
+// normal speed to the object ball. The spin and the pocket jaws are not modeled : a ball
+// reaching a rail in front of a pocket is counted in.
+//
+// The prediction is only computed again when the aim, the force or the balls changed,
+// so it costs nothing on the frames the cue does not move.
+
+#include <vector>
+#include <chrono>
+
+#include <glm/glm.hpp>
+
+#include "ball_physics.h"
+#include "precision.h"
+
+
+const int AIM_MAX_BOUNCES = 4;   // Rail bounces traced per path
+
+
+// Straight segments of a ball path
+struct AimPath {
+    std::vector<glm::vec2> points;   // Start, rail bounces, end
+    int ball = -1;       // Ball touched at the end, -1 if none
+    int pocket = -1;     // Pocket entered at the end, -1 if none
+    float speed = 0.0f;  // Speed at the end
+    glm::vec2 direction = glm::vec2(0.0f);   // At the end
+
+    void clear() {
+        points.clear();
+        ball = -1;
+        pocket = -1;
+        speed = 0.0f;
+    }
+
+    glm::vec2 end() const {
+        return points.back();
+    }
+};
+
+struct AimPrediction {
+    AimPath cue;        // Cue ball to the first contact (ghost ball at its end)
+    AimPath object;     // Ball hit, after the contact
+    AimPath cueAfter;   // Cue ball, after the contact
+
+    bool hit() const {
+        return cue.ball >= 0;
+    }
+};
+
+
+class AimPredictor
+{
+public:
+    AimPrediction prediction;
+    double computeSeconds = 0.0;   // Time of the last computation
+    long computations = 0;
+
+    // Predict the shot of the cue ball (ball 0) of balls, at angle azimuthal (degrees) with force.
+    // State is a BallState or a TableFrame.
+    // Return true if the prediction was computed again
+    template<typename State>
+    bool update(const State& balls, const std::vector<PoolPocket>& pockets, float maxX, float maxY, float azimuthal, float force) {
+        if (!changed(balls, azimuthal, force)) return false;
+
+        auto start = std::chrono::steady_clock::now();
+        compute(pockets, maxX, maxY, azimuthal, force);
+        computeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        computations++;
+        return true;
+    }
+
+private:
+    // Inputs of the last prediction
+    bool valid = false;
+    float lastAzimuthal = 0.0f;
+    float lastForce = 0.0f;
+    std::vector<glm::vec2> centers;
+    std::vector<float> radius;
+    std::vector<bool> inPocket;
+
+    template<typename State>
+    bool changed(const State& balls, float azimuthal, float force) {
+        bool same = valid && azimuthal == lastAzimuthal && force == lastForce && (int)centers.size() == balls.size();
+        for (int i = 0; same && i < balls.size(); i++) {
+            same = centers[i] == glm::vec2(balls.position(i)) && inPocket[i] == balls.inPocket(i);
+        }
+        if (same) return false;
+
+        valid = true;
+        lastAzimuthal = azimuthal;
+        lastForce = force;
+        centers.resize(balls.size());
+        radius.resize(balls.size());
+        inPocket.resize(balls.size());
+        for (int i = 0; i < balls.size(); i++) {
+            centers[i] = glm::vec2(balls.position(i));
+            radius[i] = toFloat(balls.radius[i]);
+            inPocket[i] = balls.inPocket(i);
+        }
+        return true;
+    }
+
+    void compute(const std::vector<PoolPocket>& pockets, float maxX, float maxY, float azimuthal, float force) {
+        prediction.cue.clear();
+        prediction.object.clear();
+        prediction.cueAfter.clear();
+        if (centers.empty() || inPocket[0]) return;
+
+        // Same direction as impulseBall
+        glm::vec2 direction = glm::vec2(glm::cos(glm::radians(azimuthal)), glm::sin(glm::radians(azimuthal)));
+        trace(0, -1, centers[0], direction, force, pockets, maxX, maxY, prediction.cue);
+
+        AimPath& cue = prediction.cue;
+        if (cue.ball < 0) return;
+
+        // Collision of two equal masses at the ghost ball position
+        glm::vec2 ghost = cue.end();
+        glm::vec2 normal = glm::normalize(centers[cue.ball] - ghost);
+        glm::vec2 velocity = cue.direction * cue.speed;
+        float vn = glm::dot(velocity, normal) * (1.0f + RESTITUTION) * 0.5f;
+
+        trace(cue.ball, 0, centers[cue.ball], normal, vn, pockets, maxX, maxY, prediction.object);
+
+        glm::vec2 after = velocity - normal * vn;
+        float speed = glm::length(after);
+        if (speed > 0.0f) {
+            trace(0, cue.ball, ghost, after / speed, speed, pockets, maxX, maxY, prediction.cueAfter);
+        }
+        else {
+            prediction.cueAfter.points.push_back(ghost);
+        }
+    }
+
+    // Path of ball from position, ignoring the ball ignored (-1 : none)
+    void trace(int ball, int ignored, glm::vec2 position, glm::vec2 direction, float speed,
+               const std::vector<PoolPocket>& pockets, float maxX, float maxY, AimPath& path) const {
+        const float decay = FRICTION / MASS;   // Speed lost per unit of distance
+        float r = radius[ball];
+        glm::vec2 bounds = glm::vec2(maxX - r, maxY - r);
+
+        path.points.push_back(position);
+        float distance = glm::max(0.0f, (speed - STOP_TH) / decay);
+
+        for (int bounce = 0; bounce <= AIM_MAX_BOUNCES && distance > 0.0f; bounce++) {
+            // First ball on the way
+            float tBall = distance;
+            int hit = -1;
+            for (int j = 0; j < (int)centers.size(); j++) {
+                if (j == ball || j == ignored || inPocket[j]) continue;
+
+                float t = rayCircle(position, direction, centers[j], r + radius[j]);
+                if (t >= 0.0f && t < tBall) {
+                    tBall = t;
+                    hit = j;
+                }
+            }
+
+            // First rail on the way
+            float tRail = distance;
+            int axis = -1;
+            for (int a = 0; a < 2; a++) {
+                if (direction[a] == 0.0f) continue;
+
+                float limit = direction[a] > 0.0f ? bounds[a] : -bounds[a];
+                float t = glm::max(0.0f, (limit - position[a]) / direction[a]);
+                if (t < tRail) {
+                    tRail = t;
+                    axis = a;
+                }
+            }
+
+            float t = glm::min(tBall, tRail);
+            position += direction * t;
+            distance -= t;
+            speed -= decay * t;
+            path.points.push_back(position);
+
+            if (hit >= 0 && tBall <= tRail) {
+                path.ball = hit;
+                break;
+            }
+            if (axis < 0) break;
+
+            int pocket = pocketAt(position, pockets);
+            if (pocket >= 0) {
+                path.pocket = pocket;
+                break;
+            }
+            direction[axis] = -direction[axis];
+        }
+
+        path.speed = glm::max(0.0f, speed);
+        path.direction = direction;
+    }
+
+    // Distance along the ray to the circle, -1 if missed or behind
+    static float rayCircle(glm::vec2 origin, glm::vec2 direction, glm::vec2 center, float radius) {
+        glm::vec2 d = origin - center;
+        float b = glm::dot(d, direction);
+        float c = glm::dot(d, d) - radius * radius;
+        if (c <= 0.0f) return b < 0.0f ? 0.0f : -1.0f;   // Touching : only moving into the ball counts
+
+        float discriminant = b * b - c;
+        if (b >= 0.0f || discriminant < 0.0f) return -1.0f;
+        return -b - glm::sqrt(discriminant);
+    }
+
+    // Pocket whose mouth is in front of a ball on a rail at position (see checkPocket)
+    static int pocketAt(glm::vec2 position, const std::vector<PoolPocket>& pockets) {
+        for (int p = 0; p < (int)pockets.size(); p++) {
+            const PoolPocket& pocket = pockets[p];
+            glm::vec2 center = glm::vec2(pocket.Position);
+            glm::vec2 axis = glm::normalize(glm::vec2(pocket.Direction));
+            glm::vec2 d = position - center;
+
+            if (glm::dot(d, d) > pocket.minDist * pocket.minDist) continue;
+
+            glm::vec2 lateral = d - axis * glm::dot(d, axis);
+            if (glm::dot(lateral, lateral) <= pocket.Radius * pocket.Radius) return p;
+        }
+        return -1;
+    }
+};
+
+#endif /* AIM_PREDICTOR_H */
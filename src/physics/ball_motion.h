@@ -0,0 +1,225 @@
+#ifndef BALL_MOTION_H
+#define BALL_MOTION_H
+
+// Motion of a ball on the cloth between two collisions, in closed form. The cloth acts
+// on the contact point under the ball, and the motion goes through phases of constant
+// deceleration :
+//   sliding  : the contact point slips, u = v + w x (0, 0, -R) is not zero. The kinetic
+//              friction slows the slip in its own direction until the ball rolls,
+//              after 2|u| / (7.mu_s.g)
+//   rolling  : no slip, the rolling resistance stops the ball after |v| / (mu_r.g)
+//   spinning : the ball only turns around the vertical, until the spin friction stops it
+// The spin around the vertical slows down in every phase. Within a phase of deceleration a
+// along the direction d :
+//   v(t) = v0 - a.t.d
+//   p(t) = p0 + v0.t - a.t^2/2.d
+// so that a ball is moved to any time of the phase, or straight to its next phase change,
+// in one evaluation whatever the time step.
+// Computed in double whatever the precision of the BallState.
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include "ball_state.h"
+#include "ball_physics.h"
+#include "integrator.h"
+
+
+// Table units : 1 unit = 9.6 mm (1.92 m over 200 units)
+const double BALL_GRAVITY = 1022.0;       // 9.81 m/s^2
+const double SLIDING_FRICTION = 0.2;      // Ball on cloth
+const double ROLLING_FRICTION = 0.05;     // Above a real cloth (about 0.01), so that a shot stops within a few table lengths
+const double SPINNING_FRICTION = 0.044;
+const double ROLLING_SLIP = 1e-3;         // Slip speed under which the ball rolls
+
+enum MotionPhase {
+    MOTION_STATIONARY = 0,
+    MOTION_SPINNING,
+    MOTION_ROLLING,
+    MOTION_SLIDING,
+    MOTION_PHASE_COUNT
+};
+
+
+struct BallMotion {
+    double x = 0.0, y = 0.0;                // Position
+    double vx = 0.0, vy = 0.0;              // Velocity
+    double wx = 0.0, wy = 0.0, wz = 0.0;    // Angular velocity, z up
+    double radius = RADIUS;
+
+    BallMotion() {}
+
+    template<typename Real>
+    BallMotion(const BasicBallState<Real>& s, int i) :
+        x(toDouble(s.x[i])), y(toDouble(s.y[i])),
+        vx(toDouble(s.vx[i])), vy(toDouble(s.vy[i])),
+        wx(toDouble(s.wx[i])), wy(toDouble(s.wy[i])), wz(toDouble(s.wz[i])),
+        radius(toDouble(s.radius[i]))
+    {}
+
+    template<typename Real>
+    void store(BasicBallState<Real>& s, int i) const {
+        s.x[i] = Real(x);
+        s.y[i] = Real(y);
+        s.vx[i] = Real(vx);
+        s.vy[i] = Real(vy);
+        s.wx[i] = Real(wx);
+        s.wy[i] = Real(wy);
+        s.wz[i] = Real(wz);
+    }
+
+    // Velocity of the contact point on the cloth
+    double slipX() const {
+        return vx - radius * wy;
+    }
+
+    double slipY() const {
+        return vy + radius * wx;
+    }
+
+    MotionPhase phase() const {
+        if (std::hypot(slipX(), slipY()) > ROLLING_SLIP) return MOTION_SLIDING;
+        if (vx != 0.0 || vy != 0.0) return MOTION_ROLLING;
+        if (wz != 0.0) return MOTION_SPINNING;
+        return MOTION_STATIONARY;
+    }
+
+    // Time to the end of the current phase, infinite when stationary
+    double phaseDuration() const {
+        switch (phase()) {
+            case MOTION_SLIDING:
+                return 2.0 * std::hypot(slipX(), slipY()) / (7.0 * SLIDING_FRICTION * BALL_GRAVITY);
+            case MOTION_ROLLING:
+                return std::hypot(vx, vy) / (ROLLING_FRICTION * BALL_GRAVITY);
+            case MOTION_SPINNING:
+                return std::abs(wz) / spinDeceleration();
+            default:
+                return std::numeric_limits<double>::infinity();
+        }
+    }
+
+    // Advance by t within the current phase, or to its end if it is shorter.
+    // Return the time advanced
+    double advance(double t) {
+        MotionPhase current = phase();
+        double duration = phaseDuration();
+        bool end = t >= duration;
+        if (end) t = duration;
+
+        if (current == MOTION_SLIDING) {
+            double u = std::hypot(slipX(), slipY());
+            double dx = slipX() / u;
+            double dy = slipY() / u;
+            double a = SLIDING_FRICTION * BALL_GRAVITY;
+            double b = 2.5 * a / radius;   // Angular deceleration, torque of the friction over 2/5.m.R^2
+
+            x += vx * t - 0.5 * a * t * t * dx;
+            y += vy * t - 0.5 * a * t * t * dy;
+            vx -= a * t * dx;
+            vy -= a * t * dy;
+            wx -= b * t * dy;
+            wy += b * t * dx;
+
+            if (end) roll();
+        }
+        else if (current == MOTION_ROLLING) {
+            double speed = std::hypot(vx, vy);
+            double dx = vx / speed;
+            double dy = vy / speed;
+            double a = ROLLING_FRICTION * BALL_GRAVITY;
+
+            x += vx * t - 0.5 * a * t * t * dx;
+            y += vy * t - 0.5 * a * t * t * dy;
+            vx = end ? 0.0 : vx - a * t * dx;
+            vy = end ? 0.0 : vy - a * t * dy;
+            roll();
+        }
+
+        // Spin around the vertical, slowed down in every phase
+        if (current != MOTION_STATIONARY) {
+            double spin = std::max(0.0, std::abs(wz) - spinDeceleration() * t);
+            wz = (current == MOTION_SPINNING && end) ? 0.0 : std::copysign(spin, wz);
+        }
+        return t;
+    }
+
+    // Jump to the next phase change. Return the time it took, infinite when stationary
+    double advanceToNextPhase() {
+        double duration = phaseDuration();
+        if (std::isinf(duration)) return duration;
+        return advance(duration);
+    }
+
+    // Advance by t through the phase changes
+    void evolve(double t) {
+        for (int p = 0; p < MOTION_PHASE_COUNT && t > 0.0 && phase() != MOTION_STATIONARY; p++) {
+            t -= advance(t);
+        }
+    }
+
+    // Time until the ball stops if nothing hits it
+    double timeToRest() const {
+        BallMotion m = *this;
+        double time = 0.0;
+        for (int p = 0; p < MOTION_PHASE_COUNT && m.phase() != MOTION_STATIONARY; p++) {
+            time += m.advanceToNextPhase();
+        }
+        return time;
+    }
+
+private:
+    double spinDeceleration() const {
+        return 2.5 * SPINNING_FRICTION * BALL_GRAVITY / radius;
+    }
+
+    // Angular velocity of rolling without slipping
+    void roll() {
+        wx = -vy / radius;
+        wy = vx / radius;
+    }
+};
+
+
+// Fixed step with the phases : the balls on the cloth move in closed form, exact whatever
+// deltaTime between two collisions. The balls falling in a pocket keep the integration
+// of integrator.h
+template<typename Real>
+inline void integrateBallMotion(BasicBallState<Real>& s, RealStep<Real> deltaTime) {
+    double dt = toDouble(deltaTime);
+
+    for (int i = 0; i < s.size(); i++) {
+        if (s.sleeping(i)) continue;
+        if (s.inPocket(i)) {
+            // The spin is lost in the pocket
+            s.wx[i] = s.wy[i] = s.wz[i] = Real(0);
+            integrateBallsScalar(s, i, i + 1, deltaTime, Real(FRICTION), Real(STOP_TH));
+            continue;
+        }
+
+        s.lx[i] = s.x[i];
+        s.ly[i] = s.y[i];
+        s.lz[i] = s.z[i];
+
+        BallMotion m(s, i);
+        double vx0 = m.vx, vy0 = m.vy;
+        m.evolve(dt);
+        m.store(s, i);
+
+        // Mean acceleration over the step
+        if (dt > 0.0) {
+            s.ax[i] = Real((m.vx - vx0) / dt);
+            s.ay[i] = Real((m.vy - vy0) / dt);
+        }
+    }
+}
+
+// Back to a model without spin (friction proportional to the velocity, event-driven)
+template<typename Real>
+inline void clearSpin(BasicBallState<Real>& s) {
+    for (int i = 0; i < s.size(); i++) {
+        s.wx[i] = s.wy[i] = s.wz[i] = Real(0);
+    }
+}
+
+#endif /* BALL_MOTION_H */
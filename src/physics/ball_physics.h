@@ -0,0 +1,357 @@
+#ifndef BALL_PHYSICS_H
+#define BALL_PHYSICS_H
+
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtx/rotate_vector.hpp>
+
+#include "ball_state.h"
+#include "integrator.h"
+#include "table_geometry.h"
+#include "physics_stats.h"
+
+
+const float MASS = 1.0f;
+const float RADIUS = 2.7f;
+const float FRICTION = 1.0f;
+const float RESTITUTION = 0.9f;
+const float STOP_TH = 0.5f;
+const float CONTACT_SLOP = 1e-4f;  // Overlap tolerated between resting balls
+const float CONTACT_TOUCH = 1e-2f; // Gap under which two balls touch (impulse without overlap)
+
+
+// ------------------------------------------------------------------------
+// Ball physics, running over the BallState arrays.
+// Templated on the precision (see precision.h), the constants are converted with Real(x)
+
+template<typename Real>
+inline void integrateBalls(BasicBallState<Real>& s, RealStep<Real> deltaTime) {
+    integrateBallsScalar(s, 0, s.size(), deltaTime, Real(FRICTION), Real(STOP_TH));
+}
+
+// Float : vector kernel selected for the CPU
+inline void integrateBalls(BallState& s, float deltaTime) {
+    integrateKernel()(s, 0, s.size(), deltaTime, FRICTION, STOP_TH);
+}
+
+template<typename Real>
+inline bool checkCollision(const BasicBallState<Real>& s, int i, int j) {
+    if (s.inPocket(i) || s.inPocket(j)) return false;
+
+    Real minDist = s.radius[i] + s.radius[j];
+    Real dx = s.x[i] - s.x[j];
+    Real dy = s.y[i] - s.y[j];
+    return dx*dx + dy*dy <= minDist*minDist;
+}
+
+// Return true if the contact was resolved (the balls were separated or bounced)
+template<typename Real>
+inline bool handleCollision(BasicBallState<Real>& s, int i, int j) {
+    Real dx = s.x[i] - s.x[j];
+    Real dy = s.y[i] - s.y[j];
+    Real dist = realSqrt(dx*dx + dy*dy);
+    if (dist == Real(0)) return false;
+
+    Real nx = dx / dist;
+    Real ny = dy / dist;
+
+    Real correction = s.radius[i] + s.radius[j] - dist;
+    Real vn = (s.vx[i] - s.vx[j]) * nx + (s.vy[i] - s.vy[j]) * ny;
+
+    // Resting contact : nothing to do, the balls may stay asleep
+    if (correction <= Real(CONTACT_SLOP) && vn >= Real(0)) return false;
+
+    s.wake(i);
+    s.wake(j);
+
+    Real invM1 = s.invMass[i];
+    Real invM2 = s.invMass[j];
+    Real sumInvM = invM1 + invM2;   // M1.M2/(M1+M2)
+
+    // Correct Overlapping
+    s.x[i] += nx * correction * invM1/sumInvM;
+    s.y[i] += ny * correction * invM1/sumInvM;
+    s.x[j] -= nx * correction * invM2/sumInvM;
+    s.y[j] -= ny * correction * invM2/sumInvM;
+
+    // Compute impulse
+    if (vn > Real(0)) return true;
+    Real impulse = -(Real(1) + Real(RESTITUTION)) * vn/sumInvM;
+
+    // Update velocities
+    s.vx[i] += nx * impulse * invM1;
+    s.vy[i] += ny * impulse * invM1;
+    s.vx[j] -= nx * impulse * invM2;
+    s.vy[j] -= ny * impulse * invM2;
+    return true;
+}
+
+// Balls touching without overlapping (a row of balls after a correction) : only the
+// impulse, if they get closer. Return true if it was applied
+template<typename Real>
+inline bool handleTouchingContact(BasicBallState<Real>& s, int i, int j) {
+    Real dx = s.x[i] - s.x[j];
+    Real dy = s.y[i] - s.y[j];
+    Real minDist = s.radius[i] + s.radius[j] + Real(CONTACT_TOUCH);
+    Real dist2 = dx*dx + dy*dy;
+    if (dist2 > minDist*minDist || dist2 == Real(0)) return false;
+
+    Real dist = realSqrt(dist2);
+    Real nx = dx / dist;
+    Real ny = dy / dist;
+    Real vn = (s.vx[i] - s.vx[j]) * nx + (s.vy[i] - s.vy[j]) * ny;
+    if (vn >= Real(0)) return false;
+
+    s.wake(i);
+    s.wake(j);
+
+    Real invM1 = s.invMass[i];
+    Real invM2 = s.invMass[j];
+    Real impulse = -(Real(1) + Real(RESTITUTION)) * vn/(invM1 + invM2);
+
+    s.vx[i] += nx * impulse * invM1;
+    s.vy[i] += ny * impulse * invM1;
+    s.vx[j] -= nx * impulse * invM2;
+    s.vy[j] -= ny * impulse * invM2;
+    return true;
+}
+
+template<typename Real>
+inline bool insideBounds(const BasicBallState<Real>& s, int i, Real maxX, Real maxY) {
+    return (realAbs(s.x[i]) <= maxX - s.radius[i]) && (realAbs(s.y[i]) <= maxY - s.radius[i]);
+}
+
+template<typename Real>
+inline bool checkPocket(BasicBallState<Real>& s, int i, const PocketFeature<Real>& pocket) {
+    Real dx = s.x[i] - pocket.x;
+    Real dy = s.y[i] - pocket.y;
+    Real distance2 = dx*dx + dy*dy;
+
+    if (distance2 > pocket.minDist2) {
+        // Not close enough to the pocket
+        return false;
+    }
+
+    Real minRadius = pocket.radius - s.radius[i];
+    Real minRadius2 = minRadius*minRadius;
+
+    if (distance2 <= minRadius2) {
+        // Ball is inside the hole (throat)
+        s.flags[i] |= BALL_IN_POCKET;
+        s.pocket[i] = pocket.index;
+        return true;
+    }
+
+    Real dotProd = dx * pocket.dirX + dy * pocket.dirY;
+
+    if (dotProd < Real(0)) {
+        // Somehow behind the pocket (probably going too fast)
+        s.flags[i] |= BALL_IN_POCKET;
+        s.pocket[i] = pocket.index;
+        return true;
+    }
+
+    Real projX = pocket.x + pocket.dirX * dotProd/pocket.dirLength2;
+    Real projY = pocket.y + pocket.dirY * dotProd/pocket.dirLength2;
+    Real deltaX = s.x[i] - projX;
+    Real deltaY = s.y[i] - projY;
+    distance2 = deltaX*deltaX + deltaY*deltaY;
+
+    if (distance2 > pocket.radius2) {
+        // Not in pocket
+        return false;
+    }
+
+    if (distance2 <= minRadius2) {
+        // Ball is in the mouth but not colliding
+        return true;
+    }
+
+    Real distance = realSqrt(distance2);
+    Real nx = -deltaX / distance;
+    Real ny = -deltaY / distance;
+    Real vn = nx * s.vx[i] + ny * s.vy[i];
+
+    if (vn < Real(0)) {
+        // ball is colliding with borders of the mouth
+        
+        // Correct position
+        s.x[i] = projX + deltaX * (minRadius/distance);
+        s.y[i] = projY + deltaY * (minRadius/distance);
+
+        // Bouncing
+        s.vx[i] -= Real(2) * vn * nx;
+        s.vy[i] -= Real(2) * vn * ny;
+    }
+
+    return true;
+}
+
+template<typename Real>
+inline void updateInPocket(BasicBallState<Real>& s, int i, const PocketFeature<Real>& pocket) {
+    Real dx = s.x[i] - pocket.x;
+    Real dy = s.y[i] - pocket.y;
+    Real distance2 = dx*dx + dy*dy;
+
+    Real minRadius = pocket.radius - s.radius[i];
+
+    if(distance2 > minRadius*minRadius) {
+        // Ball is colliding with the borders of the hole
+
+        Real distance = realSqrt(distance2);
+        
+        // Correct position
+        s.x[i] = pocket.x + dx * (minRadius/distance);
+        s.y[i] = pocket.y + dy * (minRadius/distance);
+
+        // Bouncing
+        Real nx = -dx / distance;
+        Real ny = -dy / distance;
+        Real vn = nx * s.vx[i] + ny * s.vy[i];
+        if (vn < Real(0)) {
+            s.vx[i] = (s.vx[i] - Real(2) * vn * nx) * Real(0.7f);
+            s.vy[i] = (s.vy[i] - Real(2) * vn * ny) * Real(0.7f);
+        }
+    }
+    // falling in the hole
+    s.az[i] = Real(-200);
+    if (s.z[i] < -pocket.depth) {
+        s.z[i] = -pocket.depth;
+        if (s.vz[i] < Real(0)) s.vz[i] *= Real(-0.8f);
+        if (realAbs(s.vz[i]) < Real(POCKET_REST_SPEED)) s.vz[i] = Real(0);
+    }
+}
+
+// Return true if the ball hit a rail
+template<typename Real>
+inline bool checkBounds(BasicBallState<Real>& s, int i, Real maxX, Real maxY) {
+    Real r = s.radius[i];
+    bool hit = false;
+
+    if (s.x[i] + r > maxX) {
+        // EAST RAIL
+        s.x[i] = maxX - r;
+        if (s.vx[i] > Real(0)) { s.vx[i] = -s.vx[i]; hit = true; }
+    }
+    else if (s.x[i] - r < -maxX) {
+        // WEST RAIL
+        s.x[i] = r - maxX;
+        if (s.vx[i] < Real(0)) { s.vx[i] = -s.vx[i]; hit = true; }
+    }
+    
+    if (s.y[i] + r > maxY) {
+        // NORTH RAIL
+        s.y[i] = maxY - r;
+        if (s.vy[i] > Real(0)) { s.vy[i] = -s.vy[i]; hit = true; }
+    }
+    else if (s.y[i] - r < -maxY) {
+        // SOUTH RAIL
+        s.y[i] = r - maxY;
+        if (s.vy[i] < Real(0)) { s.vy[i] = -s.vy[i]; hit = true; }
+    }
+
+    return hit;
+}
+
+// Rails and pockets. Only the pockets listed in the cell of the ball are tested :
+// the others are too far to take it. counters : pocket tests and rail hits are added to it
+template<typename Real>
+inline void checkTable(BasicBallState<Real>& s, int i, const BasicTableGeometry<Real>& table, StepCounters* counters = nullptr) {
+    (void)counters;   // Only used with the stats
+    if (s.sleeping(i)) return;
+
+    if (s.inPocket(i)) {
+        updateInPocket(s, i, table.pockets[s.pocket[i]]);
+        return;
+    }
+
+    if (insideBounds(s, i, table.maxX, table.maxY)) return;
+
+    int count;
+    const uint8_t* near = table.pocketsNear(s.x[i], s.y[i], count);
+
+    bool inPocket = false;
+    for (int k = 0; k < count; k++) {
+        POOL_STAT(if (counters) counters->pocketChecks++);
+        if (checkPocket(s, i, table.pockets[near[k]])) {
+            inPocket = true;
+            break;
+        }
+    }
+
+    if (!inPocket && checkBounds(s, i, table.maxX, table.maxY)) {
+        POOL_STAT(if (counters) counters->railHits++);
+    }
+}
+
+// A ball that did not move during the last step and has no velocity nor spin goes to sleep
+template<typename Real>
+inline void updateSleeping(BasicBallState<Real>& s) {
+    for (int i = 0; i < s.size(); i++) {
+        if (s.sleeping(i)) continue;
+
+        bool still = s.x[i] == s.lx[i] && s.y[i] == s.ly[i] && s.z[i] == s.lz[i];
+        bool atRest = s.vx[i] == Real(0) && s.vy[i] == Real(0) && s.vz[i] == Real(0);
+        bool spinning = s.wx[i] != Real(0) || s.wy[i] != Real(0) || s.wz[i] != Real(0);
+        if (still && atRest && !spinning) {
+            s.flags[i] |= BALL_SLEEPING;
+            s.ax[i] = s.ay[i] = s.az[i] = Real(0);
+        }
+    }
+}
+
+// Rotation of a ball of radius rolling without slipping by (dx, dy) on the table (z up) :
+// around the axis z x (dx, dy), by the distance over the radius
+inline glm::quat rollingRotation(float dx, float dy, float radius) {
+    float distance = glm::sqrt(dx*dx + dy*dy);
+    if (distance == 0.0f) return glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+
+    float halfAngle = 0.5f * distance / radius;
+    float s = glm::sin(halfAngle) / distance;
+    return glm::quat(glm::cos(halfAngle), -dy * s, dx * s, 0.0f);
+}
+
+// Advance the orientations by the angular velocities over deltaTime, to first order :
+// q += 1/2 (0, w) q dt, then normalized. rolling : the model stores no spin (friction
+// proportional to the velocity), its balls turn as if rolling without slipping, w = z x v / R
+template<typename Real>
+inline void rollBalls(BasicBallState<Real>& s, RealStep<Real> deltaTime, bool rolling) {
+    for (int i = 0; i < s.size(); i++) {
+        if (s.sleeping(i)) continue;
+
+        Real wx = s.wx[i], wy = s.wy[i], wz = s.wz[i];
+        if (rolling) {
+            wx = -s.vy[i] / s.radius[i];
+            wy = s.vx[i] / s.radius[i];
+            wz = Real(0);
+        }
+        if (wx == Real(0) && wy == Real(0) && wz == Real(0)) continue;
+
+        wx = wx * deltaTime * Real(0.5f);
+        wy = wy * deltaTime * Real(0.5f);
+        wz = wz * deltaTime * Real(0.5f);
+
+        Real qw = s.qw[i], qx = s.qx[i], qy = s.qy[i], qz = s.qz[i];
+        qw -= wx * s.qx[i] + wy * s.qy[i] + wz * s.qz[i];
+        qx += wx * s.qw[i] + wy * s.qz[i] - wz * s.qy[i];
+        qy += wy * s.qw[i] + wz * s.qx[i] - wx * s.qz[i];
+        qz += wz * s.qw[i] + wx * s.qy[i] - wy * s.qx[i];
+
+        Real norm = realSqrt(qw*qw + qx*qx + qy*qy + qz*qz);
+        s.qw[i] = qw / norm;
+        s.qx[i] = qx / norm;
+        s.qy[i] = qy / norm;
+        s.qz[i] = qz / norm;
+    }
+}
+
+template<typename Real>
+inline void impulseBall(BasicBallState<Real>& s, int i, float magnitude, float angle) {
+    s.wake(i);
+    s.vx[i] += Real(glm::cos(glm::radians(angle)) * magnitude);
+    s.vy[i] += Real(glm::sin(glm::radians(angle)) * magnitude);
+}
+
+#endif /* BALL_PHYSICS_H */
@@ -0,0 +1,117 @@
+#ifndef BALL_STATE_H
+#define BALL_STATE_H
+
+#include <vector>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "precision.h"
+
+
+enum BallFlags : uint8_t {
+    BALL_IN_POCKET = 1 << 0,
+    BALL_SLEEPING = 1 << 1,   // At rest, skipped by the update until woken by a contact or an impulse
+};
+
+// Physics state of all the balls of a table, stored as a structure of arrays
+// so that the update passes only touch the data they need.
+// Real is the number type of the physics (see precision.h)
+template<typename Real>
+struct BasicBallState {
+    // Position
+    std::vector<Real> x, y, z;
+    // Position before the last physics step (used for render interpolation)
+    std::vector<Real> lx, ly, lz;
+    // Velocity
+    std::vector<Real> vx, vy, vz;
+    // Acceleration
+    std::vector<Real> ax, ay, az;
+    // Angular velocity, z up (only moved by the phases of ball_motion.h)
+    std::vector<Real> wx, wy, wz;
+    // Orientation, unit quaternion (w, x, y, z) in table coordinates
+    std::vector<Real> qw, qx, qy, qz;
+
+    std::vector<Real> radius;
+    std::vector<Real> invMass;
+    std::vector<uint8_t> flags;
+    std::vector<int8_t> pocket;  // Index of the pocket the ball entered, -1 if none
+
+    int size() const {
+        return (int)x.size();
+    }
+
+    // Add a ball at rest at the origin and return its index
+    int add(float ballRadius, float mass) {
+        for (std::vector<Real>* array : {&x, &y, &z, &lx, &ly, &lz, &vx, &vy, &vz, &ax, &ay, &az, &wx, &wy, &wz, &qx, &qy, &qz}) {
+            array->push_back(Real(0));
+        }
+        qw.push_back(Real(1));
+        radius.push_back(Real(ballRadius));
+        invMass.push_back(Real(1.0f / mass));
+        flags.push_back(0);
+        pocket.push_back(-1);
+        return size() - 1;
+    }
+
+    void reset(int i, float posX = 0.0f, float posY = 0.0f) {
+        x[i] = lx[i] = Real(posX);
+        y[i] = ly[i] = Real(posY);
+        z[i] = lz[i] = Real(0);
+        vx[i] = vy[i] = vz[i] = Real(0);
+        ax[i] = ay[i] = az[i] = Real(0);
+        wx[i] = wy[i] = wz[i] = Real(0);
+        qw[i] = Real(1);
+        qx[i] = qy[i] = qz[i] = Real(0);
+        flags[i] = 0;
+        pocket[i] = -1;
+    }
+
+    bool inPocket(int i) const {
+        return flags[i] & BALL_IN_POCKET;
+    }
+
+    bool sleeping(int i) const {
+        return flags[i] & BALL_SLEEPING;
+    }
+
+    void wake(int i) {
+        flags[i] &= ~BALL_SLEEPING;
+    }
+
+    bool allSleeping() const {
+        for (uint8_t f : flags) {
+            if (!(f & BALL_SLEEPING)) return false;
+        }
+        return true;
+    }
+
+    // Float vectors, for the renderer and the cue
+    glm::vec3 position(int i) const {
+        return glm::vec3(toFloat(x[i]), toFloat(y[i]), toFloat(z[i]));
+    }
+
+    glm::vec3 lastPosition(int i) const {
+        return glm::vec3(toFloat(lx[i]), toFloat(ly[i]), toFloat(lz[i]));
+    }
+
+    glm::vec3 velocity(int i) const {
+        return glm::vec3(toFloat(vx[i]), toFloat(vy[i]), toFloat(vz[i]));
+    }
+
+    glm::quat orientation(int i) const {
+        return glm::quat(toFloat(qw[i]), toFloat(qx[i]), toFloat(qy[i]), toFloat(qz[i]));
+    }
+
+    void setOrientation(int i, glm::quat q) {
+        qw[i] = Real(q.w);
+        qx[i] = Real(q.x);
+        qy[i] = Real(q.y);
+        qz[i] = Real(q.z);
+    }
+};
+
+typedef BasicBallState<float> BallState;
+
+#endif /* BALL_STATE_H */
@@ -0,0 +1,162 @@
+#ifndef BROADPHASE_H
+#define BROADPHASE_H
+
+#include <vector>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+
+#include "ball_state.h"
+
+
+struct BallPair {
+    int i;
+    int j;
+};
+
+// Put the pairs in (i, j) order, whatever the broadphase that found them.
+// The collision response depends on the order the pairs are handled in
+inline void sortPairs(std::vector<BallPair>& pairs) {
+    std::sort(pairs.begin(), pairs.end(), [](const BallPair& a, const BallPair& b) {
+        return a.i < b.i || (a.i == b.i && a.j < b.j);
+    });
+}
+
+// Finds the pairs of balls that may be colliding. The exact test is done afterwards
+template<typename Real>
+class BasicBroadphase
+{
+public:
+    // Also report the pairs of sleeping balls, that the contact solver may wake
+    // one after the other in a step (see ContactIslands)
+    bool sleepingPairs = false;
+
+    virtual ~BasicBroadphase() {}
+
+    static bool bothSleeping(const BasicBallState<Real>& s, int i, int j) {
+        return s.flags[i] & s.flags[j] & BALL_SLEEPING;
+    }
+
+    bool skipPair(const BasicBallState<Real>& s, int i, int j) const {
+        return !sleepingPairs && bothSleeping(s, i, j);
+    }
+
+    // Fill pairs with candidate pairs (i < j) of balls on the table.
+    // Pocketed balls and pairs of sleeping balls (unless sleepingPairs) are ignored
+    virtual void findPairs(const BasicBallState<Real>& s, std::vector<BallPair>& pairs) = 0;
+};
+
+
+// Reference implementation : every pair is a candidate
+template<typename Real>
+class BasicBruteForceBroadphase : public BasicBroadphase<Real>
+{
+public:
+    void findPairs(const BasicBallState<Real>& s, std::vector<BallPair>& pairs) override {
+        pairs.clear();
+        int count = s.size();
+
+        for (int i = 0; i < count; i++) {
+            if (s.inPocket(i)) continue;
+
+            for (int j = i+1; j < count; j++) {
+                if (s.inPocket(j) || this->skipPair(s, i, j)) continue;
+                pairs.push_back({i, j});
+            }
+        }
+    }
+};
+
+
+// Uniform grid over the table : with cells at least as large as a ball diameter,
+// touching balls are always in the same or in neighbouring cells.
+template<typename Real>
+class BasicGridBroadphase : public BasicBroadphase<Real>
+{
+public:
+    BasicGridBroadphase(float maxX, float maxY, float cellSize) {
+        resize(maxX, maxY, cellSize);
+    }
+
+    // Grid covering [-maxX, maxX] x [-maxY, maxY], balls outside are clamped to the border cells
+    void resize(float maxX, float maxY, float cellSize) {
+        this->maxX = maxX;
+        this->maxY = maxY;
+        invCellSize = 1.0f / cellSize;
+        cellsX = std::max(1, (int)glm::ceil(2.0f * maxX * invCellSize));
+        cellsY = std::max(1, (int)glm::ceil(2.0f * maxY * invCellSize));
+        cellStart.assign(cellsX * cellsY + 1, 0);
+    }
+
+    void findPairs(const BasicBallState<Real>& s, std::vector<BallPair>& pairs) override {
+        pairs.clear();
+        int count = s.size();
+        ballCell.resize(count);
+        cellBalls.resize(count);
+
+        // Counting sort of the balls by cell
+        std::fill(cellStart.begin(), cellStart.end(), 0);
+        for (int i = 0; i < count; i++) {
+            if (s.inPocket(i)) {
+                ballCell[i] = -1;
+                continue;
+            }
+            ballCell[i] = cellIndex(cellX(toFloat(s.x[i])), cellY(toFloat(s.y[i])));
+            cellStart[ballCell[i] + 1]++;
+        }
+        for (int c = 0; c < cellsX * cellsY; c++) {
+            cellStart[c + 1] += cellStart[c];
+        }
+        cellFill.assign(cellStart.begin(), cellStart.end() - 1);
+        for (int i = 0; i < count; i++) {
+            if (ballCell[i] < 0) continue;
+            cellBalls[cellFill[ballCell[i]]++] = i;
+        }
+
+        // Candidates are the balls of the 3x3 neighbourhood
+        for (int i = 0; i < count; i++) {
+            if (ballCell[i] < 0) continue;
+
+            int cx = ballCell[i] % cellsX;
+            int cy = ballCell[i] / cellsX;
+
+            for (int ny = std::max(cy - 1, 0); ny <= std::min(cy + 1, cellsY - 1); ny++) {
+                for (int nx = std::max(cx - 1, 0); nx <= std::min(cx + 1, cellsX - 1); nx++) {
+                    int c = cellIndex(nx, ny);
+                    for (int k = cellStart[c]; k < cellStart[c + 1]; k++) {
+                        int j = cellBalls[k];
+                        if (j > i && !this->skipPair(s, i, j)) pairs.push_back({i, j});
+                    }
+                }
+            }
+        }
+    }
+
+private:
+    float maxX, maxY;
+    float invCellSize;
+    int cellsX, cellsY;
+
+    std::vector<int> cellStart;  // Start of each cell in cellBalls (prefix sums)
+    std::vector<int> cellFill;
+    std::vector<int> cellBalls;  // Ball indices sorted by cell
+    std::vector<int> ballCell;
+
+    int cellX(float x) const {
+        return glm::clamp((int)glm::floor((x + maxX) * invCellSize), 0, cellsX - 1);
+    }
+
+    int cellY(float y) const {
+        return glm::clamp((int)glm::floor((y + maxY) * invCellSize), 0, cellsY - 1);
+    }
+
+    int cellIndex(int cx, int cy) const {
+        return cy * cellsX + cx;
+    }
+};
+
+typedef BasicBroadphase<float> Broadphase;
+typedef BasicBruteForceBroadphase<float> BruteForceBroadphase;
+typedef BasicGridBroadphase<float> GridBroadphase;
+
+#endif /* BROADPHASE_H */
@@ -0,0 +1,49 @@
+#ifndef BYTE_ORDER_H
+#define BYTE_ORDER_H
+
+// Fixed size values of the replays and of the rollback packets (see replay.h and
+// rollback_peer.h), written and read little endian whatever the byte order of the
+// machine. Floats are written as the little endian bits of their IEEE 754 value.
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
+
+// Unsigned integer of the size of T
+template<typename T>
+struct ByteOrderBits {
+    static_assert(std::is_arithmetic<T>::value && (sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8),
+                  "Only integers and floats of 1, 2, 4 or 8 bytes");
+    typedef typename std::conditional<sizeof(T) == 1, uint8_t,
+            typename std::conditional<sizeof(T) == 2, uint16_t,
+            typename std::conditional<sizeof(T) == 4, uint32_t, uint64_t>::type>::type>::type Type;
+};
+
+template<typename T>
+inline void writeValue(std::vector<uint8_t>& out, T value) {
+    typename ByteOrderBits<T>::Type bits;
+    std::memcpy(&bits, &value, sizeof(T));
+    for (size_t b = 0; b < sizeof(T); b++) {
+        out.push_back((uint8_t)((uint64_t)bits >> (8 * b)));
+    }
+}
+
+// Return false if there are less than sizeof(T) bytes left
+template<typename T>
+inline bool readValue(const uint8_t*& data, const uint8_t* end, T& value) {
+    if ((size_t)(end - data) < sizeof(T)) return false;
+
+    uint64_t bits = 0;
+    for (size_t b = 0; b < sizeof(T); b++) {
+        bits |= (uint64_t)data[b] << (8 * b);
+    }
+    typename ByteOrderBits<T>::Type sized = (typename ByteOrderBits<T>::Type)bits;
+    std::memcpy(&value, &sized, sizeof(T));
+    data += sizeof(T);
+    return true;
+}
+
+#endif /* BYTE_ORDER_H */
@@ -0,0 +1,170 @@
+#ifndef CONTACT_ISLANDS_H
+#define CONTACT_ISLANDS_H
+
+// Contact islands : the touching pairs of a step are grouped by connected balls, and
+// every island is solved on its own by a few passes of sequential impulses over its
+// contacts. An impulse then travels through a row of touching balls in one step
+// instead of one ball per step.
+// The islands share no ball, so they can be solved on different threads with the
+// same results as on one.
+
+#include <vector>
+#include <algorithm>
+
+#include "ball_state.h"
+#include "ball_physics.h"
+#include "broadphase.h"
+#include "thread_pool.h"
+
+
+const int CONTACT_ITERATIONS = 4;                 // Passes over the contacts of an island
+const float CONTACT_MARGIN = 1.0f;                // Gap under which a pair joins the island, table units
+const int PARALLEL_ISLAND_MIN_CONTACTS = 512;     // Below, the islands are solved on the calling thread
+
+
+class ContactIslands
+{
+public:
+    // Solve the contacts among the candidate pairs, on the workers of pool if it is
+    // given and the step has enough contacts. Return the contacts resolved
+    template<typename Real>
+    int solve(BasicBallState<Real>& s, const std::vector<BallPair>& pairs, int iterations, ThreadPool* pool = nullptr) {
+        findIslands(s, pairs);
+
+        int islandCount = size();
+        resolved.assign(islandCount, 0);
+        if (islandCount == 0) return 0;
+
+        if (pool && pool->size() > 1 && (int)contacts.size() >= PARALLEL_ISLAND_MIN_CONTACTS) {
+            // Largest islands first, so that a large one does not end the step alone
+            order.resize(islandCount);
+            for (int k = 0; k < islandCount; k++) {
+                order[k] = k;
+            }
+            std::sort(order.begin(), order.end(), [this](int a, int b) {
+                return islandSize(a) > islandSize(b) || (islandSize(a) == islandSize(b) && a < b);
+            });
+
+            int grain = std::max(1, islandCount / (pool->size() * 8));
+            pool->parallelFor(islandCount, grain, [this, &s, iterations](int begin, int end, int) {
+                for (int k = begin; k < end; k++) {
+                    solveIsland(s, order[k], iterations);
+                }
+            });
+        }
+        else {
+            for (int k = 0; k < islandCount; k++) {
+                solveIsland(s, k, iterations);
+            }
+        }
+
+        int total = 0;
+        for (int r : resolved) {
+            total += r;
+        }
+        return total;
+    }
+
+    // Islands of the last solve
+    int size() const {
+        return (int)islandStart.size() - 1;
+    }
+
+    int islandSize(int k) const {
+        return islandStart[k + 1] - islandStart[k];
+    }
+
+private:
+    std::vector<BallPair> contacts;       // Grouped by island, in the order of the pairs within an island
+    std::vector<int> islandStart;         // Contacts of island k : contacts[islandStart[k] .. islandStart[k + 1])
+    std::vector<int> resolved;            // By island
+    std::vector<int> order;
+
+    // By ball, only valid for the balls of a contact
+    std::vector<int> parent;
+    std::vector<int> island;
+
+    std::vector<BallPair> touching;
+    std::vector<int> touchingIsland;
+    std::vector<int> fill;
+
+    int findRoot(int i) {
+        while (parent[i] != i) {
+            parent[i] = parent[parent[i]];
+            i = parent[i];
+        }
+        return i;
+    }
+
+    // Union-find over the balls of the touching pairs. The islands are numbered in the
+    // order of their first pair, so that they do not depend on the threads
+    template<typename Real>
+    void findIslands(const BasicBallState<Real>& s, const std::vector<BallPair>& pairs) {
+        // Sleeping balls only join through the balls they touch
+        touching.clear();
+        for (const BallPair& pair : pairs) {
+            bool sleeping = s.sleeping(pair.i) && s.sleeping(pair.j);
+            Real minDist = s.radius[pair.i] + s.radius[pair.j] + Real(sleeping ? CONTACT_TOUCH : CONTACT_MARGIN);
+            Real dx = s.x[pair.i] - s.x[pair.j];
+            Real dy = s.y[pair.i] - s.y[pair.j];
+            if (dx*dx + dy*dy <= minDist*minDist) touching.push_back(pair);
+        }
+
+        parent.resize(s.size());
+        island.resize(s.size());
+        for (const BallPair& pair : touching) {
+            parent[pair.i] = pair.i;
+            parent[pair.j] = pair.j;
+            island[pair.i] = island[pair.j] = -1;
+        }
+        for (const BallPair& pair : touching) {
+            int a = findRoot(pair.i);
+            int b = findRoot(pair.j);
+            if (a < b) parent[b] = a;
+            else if (b < a) parent[a] = b;
+        }
+
+        // Counting sort of the pairs by island
+        int islandCount = 0;
+        touchingIsland.resize(touching.size());
+        islandStart.assign(1, 0);
+        for (size_t c = 0; c < touching.size(); c++) {
+            int root = findRoot(touching[c].i);
+            if (island[root] < 0) {
+                island[root] = islandCount++;
+                islandStart.push_back(0);
+            }
+            touchingIsland[c] = island[root];
+            islandStart[island[root] + 1]++;
+        }
+        for (int k = 0; k < islandCount; k++) {
+            islandStart[k + 1] += islandStart[k];
+        }
+
+        contacts.resize(touching.size());
+        fill.assign(islandStart.begin(), islandStart.end() - 1);
+        for (size_t c = 0; c < touching.size(); c++) {
+            contacts[fill[touchingIsland[c]]++] = touching[c];
+        }
+    }
+
+    // Sequential impulses : every pass separates the balls that overlap and bounces
+    // the touching balls that get closer, until a pass has nothing left to do
+    template<typename Real>
+    void solveIsland(BasicBallState<Real>& s, int k, int iterations) {
+        for (int it = 0; it < iterations; it++) {
+            bool active = false;
+            for (int c = islandStart[k]; c < islandStart[k + 1]; c++) {
+                const BallPair& contact = contacts[c];
+                bool overlap = checkCollision(s, contact.i, contact.j);
+                if (overlap ? handleCollision(s, contact.i, contact.j) : handleTouchingContact(s, contact.i, contact.j)) {
+                    resolved[k]++;
+                    active = true;
+                }
+            }
+            if (!active) break;
+        }
+    }
+};
+
+#endif /* CONTACT_ISLANDS_H */
@@ -0,0 +1,119 @@
+#ifndef CUE_STATE_H
+#define CUE_STATE_H
+
+#include <glm/glm.hpp>
+
+const float COOLDOWN = 5.0f;
+const float HIT_DURATION = 0.1f;
+
+const float ROTATE_SPEED = 50.0f;
+const float DISTANCE_SPEED = 0.3f;
+const float DISTANCE_MIN = 0.05f;
+const float DISTANCE_MAX = 0.3f;
+
+// Force of the shot, from the cue at DISTANCE_MIN to the cue at DISTANCE_MAX
+const float FORCE_MIN = 50.0f;
+const float FORCE_MAX = 300.0f;
+
+
+// Aim, power and shot animation of the cue
+class CueState
+{
+public: 
+    glm::vec2 Position = glm::vec2(0.0f);
+    float azimuthal = -90.0f;
+    float latitude = 15.0f;
+    float distance = DISTANCE_MIN;
+    float force = 300.0f;
+
+    bool enabled = false;
+    bool takeInput = true;
+    float shootTimer = 0.0f;
+    float cooldownTimer = 0.0f;
+    float shotDistance = 0.0f;
+
+    // Return true if shot this frame
+    bool update(float deltaTime, glm::vec3 cueBallPos) {
+        if (!enabled) return false;
+
+        if (shootTimer > 0.0f) {
+            shootTimer -= deltaTime;
+            distance = shotDistance * shootTimer/HIT_DURATION;
+
+            if (shootTimer <= 0.0f) {
+                cooldownTimer = COOLDOWN;
+                return true;
+            }
+        }
+        else if (cooldownTimer > 0.0f) {
+            cooldownTimer -= deltaTime;
+            
+            float delta = COOLDOWN - cooldownTimer;
+            if (delta <= 1.0f) {
+                distance = delta * shotDistance;
+            }
+
+            if (cooldownTimer <= 0.0f) {
+                takeInput = true;
+                Position = glm::vec2(cueBallPos);
+                distance = shotDistance;
+            }
+        }
+        else {
+            Position = glm::vec2(cueBallPos);
+        }
+
+        return false;
+    }
+
+    // Force of a shot with the cue at the current distance
+    float shotForce() const {
+        return FORCE_MIN + (FORCE_MAX - FORCE_MIN) * (distance - DISTANCE_MIN)/(DISTANCE_MAX - DISTANCE_MIN);
+    }
+
+    void turn(int direction, float deltaTime) {
+        if (!enabled || !takeInput) return;
+
+        int dir = direction >= 0 ? 1 : -1;
+        azimuthal += dir * deltaTime * ROTATE_SPEED;
+    }
+
+    void changeDistance(int direction, float deltaTime) {
+        if (!enabled || !takeInput) return;
+
+        int dir = direction >= 0 ? 1 : -1;
+        distance += dir * deltaTime * DISTANCE_SPEED;
+        limitDistance();
+    }
+
+    void shoot() {
+        if (!enabled || !takeInput) return;
+
+        force = shotForce();
+
+        shootTimer = HIT_DURATION;
+        shotDistance = distance;
+        takeInput = false;
+    }
+
+    // Point the cue in the angle direction, pulled back for the given force
+    void aim(float angle, float shotForce) {
+        if (!enabled || !takeInput) return;
+
+        azimuthal = angle;
+        distance = DISTANCE_MIN + (DISTANCE_MAX - DISTANCE_MIN) * (shotForce - FORCE_MIN)/(FORCE_MAX - FORCE_MIN);
+        limitDistance();
+    }
+
+    void switchEnable() {
+        enabled = !enabled;
+    }
+
+private:
+    void limitDistance() {
+        if (distance > DISTANCE_MAX) distance = DISTANCE_MAX;
+        if (distance < DISTANCE_MIN) distance = DISTANCE_MIN;
+    }
+};
+
+#endif /* CUE_STATE_H */
@@ -0,0 +1,375 @@
+#ifndef EVENT_SIMULATION_H
+#define EVENT_SIMULATION_H
+
+// Event-driven simulation of the balls : instead of stepping, the time of the
+// next ball-ball, ball-rail, ball-pocket or stop event is computed analytically
+// and the simulation jumps straight to it.
+//
+// The motion between two events follows the friction of the discrete integrator
+// in closed form (dv/dt = -k.v with k = FRICTION/MASS) :
+//   v(t) = v0.exp(-k.t)
+//   p(t) = p0 + v0.s(t)   with   s(t) = (1 - exp(-k.t))/k
+// and a ball stops when its speed goes below STOP_TH.
+// All the balls must have the same mass, so that the relative motion of two balls
+// is a straight line in s and their time of impact the root of a quadratic.
+// The trajectories are computed in double whatever the precision of the BallState.
+
+#include <vector>
+#include <queue>
+#include <limits>
+
+#include <glm/glm.hpp>
+
+#include "ball_state.h"
+#include "ball_physics.h"
+
+
+enum SimEventType {
+    EVENT_BALL,     // other : index of the other ball
+    EVENT_RAIL_X,   // East/West rail
+    EVENT_RAIL_Y,   // North/South rail
+    EVENT_STOP,
+};
+
+struct SimEvent {
+    double time;
+    SimEventType type;
+    int ball;
+    int other;
+    int ballCount;   // Trajectory counters when predicted, the event is stale if they changed
+    int otherCount;
+
+    // Ordering of the priority queue : earliest first, ties broken by type and indices
+    bool operator<(const SimEvent& e) const {
+        if (time != e.time) return time > e.time;
+        if (type != e.type) return type > e.type;
+        if (ball != e.ball) return ball > e.ball;
+        return other > e.other;
+    }
+};
+
+
+// Below this relative speed, two touching balls are considered moving together
+const double MIN_APPROACH_SPEED = 1e-6;
+
+
+class EventSimulation
+{
+public:
+    double now = 0.0;
+    long eventsProcessed = 0;
+    int ballCollisions = 0;
+    int railCollisions = 0;
+    int pocketed = 0;
+
+    EventSimulation(float maxX, float maxY) : maxX(maxX), maxY(maxY) {}
+
+    // Load the trajectories from the current state and predict all events.
+    // Must be called again whenever the state is modified from outside (impulse, reset...)
+    template<typename Real>
+    void start(const BasicBallState<Real>& s, const std::vector<PoolPocket>& pockets) {
+        this->pockets = &pockets;
+        int count = s.size();
+
+        k = count > 0 ? FRICTION * toDouble(s.invMass[0]) : FRICTION;
+        t0.assign(count, now);
+        px.resize(count); py.resize(count);
+        vx.resize(count); vy.resize(count);
+        stopTime.resize(count);
+        eventCount.assign(count, 0);
+        radius.resize(count);
+        flags = s.flags;
+        pocket = s.pocket;
+
+        for (int i = 0; i < count; i++) {
+            radius[i] = toFloat(s.radius[i]);
+            px[i] = toDouble(s.x[i]);
+            py[i] = toDouble(s.y[i]);
+            vx[i] = toDouble(s.vx[i]);
+            vy[i] = toDouble(s.vy[i]);
+            computeStopTime(i);
+        }
+
+        queue = std::priority_queue<SimEvent>();
+        for (int i = 0; i < count; i++) {
+            if (flags[i] & BALL_IN_POCKET) continue;
+            predictRailsAndStop(i);
+            for (int j = i+1; j < count; j++) {
+                predictBall(i, j);
+            }
+        }
+    }
+
+    // Process all the events in the next deltaTime and write the resulting state in s
+    template<typename Real>
+    void advance(BasicBallState<Real>& s, double deltaTime) {
+        double target = now + deltaTime;
+
+        while (!queue.empty() && queue.top().time <= target) {
+            SimEvent event = queue.top();
+            queue.pop();
+            processEvent(event);
+        }
+
+        now = target;
+        writeState(s);
+    }
+
+    // Process events until every ball has stopped, return the number of events processed
+    template<typename Real>
+    long runToRest(BasicBallState<Real>& s, long maxEvents = 100000) {
+        long processed = 0;
+
+        while (!queue.empty() && processed < maxEvents) {
+            SimEvent event = queue.top();
+            queue.pop();
+            if (processEvent(event)) processed++;
+        }
+
+        writeState(s);
+        return processed;
+    }
+
+    bool atRest() const {
+        for (int i = 0; i < (int)t0.size(); i++) {
+            if (isMoving(i)) return false;
+        }
+        return true;
+    }
+
+private:
+    float maxX, maxY;
+    double k = FRICTION;
+    const std::vector<PoolPocket>* pockets = nullptr;
+
+    // Trajectory of each ball : position and velocity at time t0
+    std::vector<double> t0, px, py, vx, vy;
+    std::vector<double> stopTime;
+    std::vector<int> eventCount;
+    std::vector<float> radius;
+    std::vector<uint8_t> flags;
+    std::vector<int8_t> pocket;
+
+    std::priority_queue<SimEvent> queue;
+
+    bool isMoving(int i) const {
+        return (vx[i] != 0.0 || vy[i] != 0.0) && !(flags[i] & BALL_IN_POCKET);
+    }
+
+    void computeStopTime(int i) {
+        double speed = glm::sqrt(vx[i]*vx[i] + vy[i]*vy[i]);
+        if (!isMoving(i)) stopTime[i] = std::numeric_limits<double>::infinity();
+        else if (speed <= STOP_TH) stopTime[i] = t0[i];
+        else stopTime[i] = t0[i] + glm::log(speed / STOP_TH) / k;
+    }
+
+    // Travel parameter s between t0 and t, and its inverse
+    double travel(double dt) const {
+        return (1.0 - glm::exp(-k * dt)) / k;
+    }
+
+    double travelTime(double s) const {
+        return -glm::log(1.0 - k * s) / k;
+    }
+
+    // Move the reference of the trajectory of ball i to time t
+    void rebase(int i, double t) {
+        if (isMoving(i)) {
+            double dt = glm::min(t, stopTime[i]) - t0[i];
+            double decay = glm::exp(-k * dt);
+            double s = (1.0 - decay) / k;
+            px[i] += vx[i] * s;
+            py[i] += vy[i] * s;
+            vx[i] *= decay;
+            vy[i] *= decay;
+            if (t >= stopTime[i]) vx[i] = vy[i] = 0.0;
+        }
+        t0[i] = t;
+    }
+
+    // The trajectory of ball i changed : older events are stale, predict the new ones
+    void changed(int i) {
+        eventCount[i]++;
+        computeStopTime(i);
+        if (flags[i] & BALL_IN_POCKET) return;
+
+        predictRailsAndStop(i);
+        for (int j = 0; j < (int)t0.size(); j++) {
+            if (j != i) predictBall(i, j);
+        }
+    }
+
+    void schedule(double time, SimEventType type, int ball, int other) {
+        int otherCount = type == EVENT_BALL ? eventCount[other] : 0;
+        queue.push({time, type, ball, other, eventCount[ball], otherCount});
+    }
+
+    void predictRailsAndStop(int i) {
+        if (!isMoving(i)) return;
+
+        double sLimit = travel(stopTime[i] - t0[i]);
+        double r = radius[i];
+
+        // Rails are reached when the center is at maxX - r (resp. maxY - r)
+        if (vx[i] != 0.0) {
+            double target = vx[i] > 0.0 ? maxX - r : r - maxX;
+            double s = glm::max((target - px[i]) / vx[i], 0.0);
+            if (s <= sLimit) schedule(t0[i] + travelTime(s), EVENT_RAIL_X, i, 0);
+        }
+        if (vy[i] != 0.0) {
+            double target = vy[i] > 0.0 ? maxY - r : r - maxY;
+            double s = glm::max((target - py[i]) / vy[i], 0.0);
+            if (s <= sLimit) schedule(t0[i] + travelTime(s), EVENT_RAIL_Y, i, 0);
+        }
+
+        schedule(stopTime[i], EVENT_STOP, i, 0);
+    }
+
+    void predictBall(int i, int j) {
+        if ((flags[i] | flags[j]) & BALL_IN_POCKET) return;
+        if (!isMoving(i) && !isMoving(j)) return;
+
+        // Both trajectories from a common reference time, valid until one of them stops
+        double t = glm::max(t0[i], t0[j]);
+        rebase(i, t);
+        rebase(j, t);
+        double tEnd = glm::min(isMoving(i) ? stopTime[i] : std::numeric_limits<double>::infinity(),
+                               isMoving(j) ? stopTime[j] : std::numeric_limits<double>::infinity());
+        double sLimit = travel(tEnd - t);
+
+        double dx = px[i] - px[j], dy = py[i] - py[j];
+        double dvx = vx[i] - vx[j], dvy = vy[i] - vy[j];
+        double minDist = radius[i] + radius[j];
+
+        // |d + dv.s| = minDist
+        double a = dvx*dvx + dvy*dvy;
+        double b = dx*dvx + dy*dvy;
+        double c = dx*dx + dy*dy - minDist*minDist;
+        if (b >= -MIN_APPROACH_SPEED * glm::sqrt(dx*dx + dy*dy)) return;    // Not approaching
+
+        double s;
+        if (c <= 0.0) s = 0.0;                 // Already touching
+        else {
+            double disc = b*b - a*c;
+            if (disc < 0.0) return;
+            s = c / (-b + glm::sqrt(disc));     // Smallest root, stable form
+        }
+
+        if (s <= sLimit) schedule(t + travelTime(s), EVENT_BALL, i, j);
+    }
+
+    // Return false if the event was stale
+    bool processEvent(const SimEvent& event) {
+        int i = event.ball;
+        if (event.ballCount != eventCount[i]) return false;
+        if (event.type == EVENT_BALL && event.otherCount != eventCount[event.other]) return false;
+
+        now = glm::max(now, event.time);
+        eventsProcessed++;
+        rebase(i, event.time);
+
+        switch (event.type) {
+        case EVENT_BALL:
+            rebase(event.other, event.time);
+            collideBalls(i, event.other);
+            ballCollisions++;
+            changed(i);
+            changed(event.other);
+            break;
+        case EVENT_RAIL_X:
+        case EVENT_RAIL_Y:
+            if (!enterPocket(i)) {
+                if (event.type == EVENT_RAIL_X) vx[i] = -vx[i];
+                else vy[i] = -vy[i];
+                railCollisions++;
+            }
+            changed(i);
+            break;
+        case EVENT_STOP:
+            vx[i] = vy[i] = 0.0;
+            changed(i);
+            break;
+        }
+        return true;
+    }
+
+    void collideBalls(int i, int j) {
+        double dx = px[i] - px[j], dy = py[i] - py[j];
+        double dist = glm::sqrt(dx*dx + dy*dy);
+        if (dist == 0.0) return;
+        double nx = dx / dist, ny = dy / dist;
+
+        double vn = (vx[i] - vx[j]) * nx + (vy[i] - vy[j]) * ny;
+        if (vn > 0.0) return;
+
+        // Equal masses
+        double impulse = -(1.0 + RESTITUTION) * vn * 0.5;
+        vx[i] += nx * impulse;
+        vy[i] += ny * impulse;
+        vx[j] -= nx * impulse;
+        vy[j] -= ny * impulse;
+    }
+
+    // The ball reaches a rail : it goes in if it is in the mouth of a pocket
+    bool enterPocket(int i) {
+        for (int p = 0; p < (int)pockets->size(); p++) {
+            const PoolPocket& candidate = (*pockets)[p];
+            double dx = px[i] - candidate.Position.x;
+            double dy = py[i] - candidate.Position.y;
+
+            if (dx*dx + dy*dy > candidate.minDist * candidate.minDist) continue;
+
+            // Distance to the axis of the pocket
+            double along = dx * candidate.Direction.x + dy * candidate.Direction.y;
+            double acrossX = dx - candidate.Direction.x * along;
+            double acrossY = dy - candidate.Direction.y * along;
+            if (acrossX*acrossX + acrossY*acrossY > candidate.Radius * candidate.Radius) continue;
+
+            flags[i] |= BALL_IN_POCKET;
+            pocket[i] = p;
+            px[i] = candidate.Position.x;
+            py[i] = candidate.Position.y;
+            vx[i] = vy[i] = 0.0;
+            pocketed++;
+            return true;
+        }
+        return false;
+    }
+
+    template<typename Real>
+    void writeState(BasicBallState<Real>& s) {
+        for (int i = 0; i < s.size(); i++) {
+            double x = px[i], y = py[i], velX = vx[i], velY = vy[i];
+            if (isMoving(i)) {
+                double dt = glm::min(now, stopTime[i]) - t0[i];
+                double decay = glm::exp(-k * dt);
+                double travelled = (1.0 - decay) / k;
+                x += velX * travelled;
+                y += velY * travelled;
+                velX = now >= stopTime[i] ? 0.0 : velX * decay;
+                velY = now >= stopTime[i] ? 0.0 : velY * decay;
+            }
+
+            s.lx[i] = s.x[i];
+            s.ly[i] = s.y[i];
+            s.lz[i] = s.z[i];
+            s.x[i] = Real(x);
+            s.y[i] = Real(y);
+            s.vx[i] = Real(velX);
+            s.vy[i] = Real(velY);
+            s.ax[i] = Real(-k * velX);
+            s.ay[i] = Real(-k * velY);
+            if (isMoving(i)) s.wake(i);
+
+            if ((flags[i] & BALL_IN_POCKET) && !s.inPocket(i)) {
+                // Drop the ball at the bottom of the pocket
+                s.flags[i] |= BALL_IN_POCKET;
+                s.pocket[i] = pocket[i];
+                s.z[i] = s.lz[i] = Real(-(*pockets)[pocket[i]].depth);
+                s.vz[i] = s.az[i] = Real(0);
+            }
+        }
+    }
+};
+
+#endif /* EVENT_SIMULATION_H */
@@ -0,0 +1,230 @@
+#ifndef INTEGRATOR_H
+#define INTEGRATOR_H
+
+// Integration kernels moving the balls of a BallState by one time step.
+// The vector kernels are for float only, the other precisions use the scalar one.
+// Every kernel gives the same result as the scalar one : the vector versions
+// only process 4 (SSE2) or 8 (AVX2) balls per instruction, the best one
+// supported by the CPU being selected at runtime.
+// Sleeping balls are left untouched.
+
+#include <cstdint>
+#include <cstring>
+
+#include <glm/glm.hpp>
+
+#include "ball_state.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define POOL_SIMD_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(POOL_SIMD_X86) && (defined(__GNUC__) || defined(__clang__))
+#define POOL_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define POOL_TARGET_AVX2
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define POOL_SIMD_SSE2
+#endif
+
+
+typedef void (*IntegrateKernel)(BallState& s, int begin, int end, float deltaTime, float friction, float stopThreshold);
+
+// Reference kernel, for every precision
+template<typename Real>
+inline void integrateBallsScalar(BasicBallState<Real>& s, int begin, int end, RealStep<Real> deltaTime, Real friction, Real stopThreshold) {
+    for (int i = begin; i < end; i++) {
+        if (s.sleeping(i)) continue;
+
+        s.lx[i] = s.x[i];
+        s.ly[i] = s.y[i];
+        s.lz[i] = s.z[i];
+
+        s.vx[i] += s.ax[i] * deltaTime;
+        s.vy[i] += s.ay[i] * deltaTime;
+        s.vz[i] += s.az[i] * deltaTime;
+
+        // Stop threshold
+        if (realAbs(s.vx[i]) < stopThreshold) s.vx[i] = Real(0);
+        if (realAbs(s.vy[i]) < stopThreshold) s.vy[i] = Real(0);
+
+        Real f = -friction * s.invMass[i];
+        s.ax[i] = s.vx[i] * f;
+        s.ay[i] = s.vy[i] * f;
+        s.az[i] = s.vz[i] * f;
+
+        s.x[i] += s.vx[i] * deltaTime;
+        s.y[i] += s.vy[i] * deltaTime;
+        s.z[i] += s.vz[i] * deltaTime;
+
+        if (!s.inPocket(i)) {
+            s.z[i] = Real(0);
+            s.vz[i] = Real(0);
+            s.az[i] = Real(0);
+        }
+    }
+}
+
+#ifdef POOL_SIMD_SSE2
+inline void integrateBallsSSE2(BallState& s, int begin, int end, float deltaTime, float friction, float stopThreshold) {
+    const __m128 dt = _mm_set1_ps(deltaTime);
+    const __m128 stop = _mm_set1_ps(stopThreshold);
+    const __m128 negFriction = _mm_set1_ps(-friction);
+    const __m128 signBit = _mm_set1_ps(-0.0f);
+    const __m128i pocketFlag = _mm_set1_epi32(BALL_IN_POCKET);
+    const __m128i sleepFlag = _mm_set1_epi32(BALL_SLEEPING);
+    const __m128i zero = _mm_setzero_si128();
+
+    int i = begin;
+    for (; i + 4 <= end; i += 4) {
+        int32_t packedFlags;
+        std::memcpy(&packedFlags, &s.flags[i], sizeof(packedFlags));
+        __m128i flags = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packedFlags), zero), zero);
+        __m128 sleeping = _mm_castsi128_ps(_mm_cmpgt_epi32(_mm_and_si128(flags, sleepFlag), zero));
+        if (_mm_movemask_ps(sleeping) == 0xF) continue;
+
+        __m128 x = _mm_loadu_ps(&s.x[i]), y = _mm_loadu_ps(&s.y[i]), z = _mm_loadu_ps(&s.z[i]);
+        __m128 vx = _mm_loadu_ps(&s.vx[i]), vy = _mm_loadu_ps(&s.vy[i]), vz = _mm_loadu_ps(&s.vz[i]);
+        __m128 ax = _mm_loadu_ps(&s.ax[i]), ay = _mm_loadu_ps(&s.ay[i]), az = _mm_loadu_ps(&s.az[i]);
+
+        _mm_storeu_ps(&s.lx[i], x);
+        _mm_storeu_ps(&s.ly[i], y);
+        _mm_storeu_ps(&s.lz[i], z);
+
+        vx = _mm_add_ps(vx, _mm_mul_ps(ax, dt));
+        vy = _mm_add_ps(vy, _mm_mul_ps(ay, dt));
+        vz = _mm_add_ps(vz, _mm_mul_ps(az, dt));
+
+        // Stop threshold
+        vx = _mm_andnot_ps(_mm_cmplt_ps(_mm_andnot_ps(signBit, vx), stop), vx);
+        vy = _mm_andnot_ps(_mm_cmplt_ps(_mm_andnot_ps(signBit, vy), stop), vy);
+
+        // Sleeping balls have no velocity nor acceleration, only the acceleration
+        // must be kept as is (0 * -friction would give -0)
+        __m128 f = _mm_mul_ps(negFriction, _mm_loadu_ps(&s.invMass[i]));
+        ax = _mm_or_ps(_mm_and_ps(sleeping, ax), _mm_andnot_ps(sleeping, _mm_mul_ps(vx, f)));
+        ay = _mm_or_ps(_mm_and_ps(sleeping, ay), _mm_andnot_ps(sleeping, _mm_mul_ps(vy, f)));
+        az = _mm_or_ps(_mm_and_ps(sleeping, az), _mm_andnot_ps(sleeping, _mm_mul_ps(vz, f)));
+
+        x = _mm_add_ps(x, _mm_mul_ps(vx, dt));
+        y = _mm_add_ps(y, _mm_mul_ps(vy, dt));
+        z = _mm_add_ps(z, _mm_mul_ps(vz, dt));
+
+        // Balls on the table stay at z = 0
+        __m128 onTable = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(flags, pocketFlag), zero));
+        z = _mm_andnot_ps(onTable, z);
+        vz = _mm_andnot_ps(onTable, vz);
+        az = _mm_andnot_ps(onTable, az);
+
+        _mm_storeu_ps(&s.x[i], x); _mm_storeu_ps(&s.y[i], y); _mm_storeu_ps(&s.z[i], z);
+        _mm_storeu_ps(&s.vx[i], vx); _mm_storeu_ps(&s.vy[i], vy); _mm_storeu_ps(&s.vz[i], vz);
+        _mm_storeu_ps(&s.ax[i], ax); _mm_storeu_ps(&s.ay[i], ay); _mm_storeu_ps(&s.az[i], az);
+    }
+
+    integrateBallsScalar(s, i, end, deltaTime, friction, stopThreshold);
+}
+#endif
+
+#ifdef POOL_SIMD_X86
+POOL_TARGET_AVX2
+inline void integrateBallsAVX2(BallState& s, int begin, int end, float deltaTime, float friction, float stopThreshold) {
+    const __m256 dt = _mm256_set1_ps(deltaTime);
+    const __m256 stop = _mm256_set1_ps(stopThreshold);
+    const __m256 negFriction = _mm256_set1_ps(-friction);
+    const __m256 signBit = _mm256_set1_ps(-0.0f);
+    const __m256i pocketFlag = _mm256_set1_epi32(BALL_IN_POCKET);
+    const __m256i sleepFlag = _mm256_set1_epi32(BALL_SLEEPING);
+    const __m256i zero = _mm256_setzero_si256();
+
+    int i = begin;
+    for (; i + 8 <= end; i += 8) {
+        __m256i flags = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)&s.flags[i]));
+        __m256 sleeping = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_and_si256(flags, sleepFlag), zero));
+        if (_mm256_movemask_ps(sleeping) == 0xFF) continue;
+
+        __m256 x = _mm256_loadu_ps(&s.x[i]), y = _mm256_loadu_ps(&s.y[i]), z = _mm256_loadu_ps(&s.z[i]);
+        __m256 vx = _mm256_loadu_ps(&s.vx[i]), vy = _mm256_loadu_ps(&s.vy[i]), vz = _mm256_loadu_ps(&s.vz[i]);
+        __m256 ax = _mm256_loadu_ps(&s.ax[i]), ay = _mm256_loadu_ps(&s.ay[i]), az = _mm256_loadu_ps(&s.az[i]);
+
+        _mm256_storeu_ps(&s.lx[i], x);
+        _mm256_storeu_ps(&s.ly[i], y);
+        _mm256_storeu_ps(&s.lz[i], z);
+
+        // Separate mul and add (no FMA) to match the scalar kernel bit for bit
+        vx = _mm256_add_ps(vx, _mm256_mul_ps(ax, dt));
+        vy = _mm256_add_ps(vy, _mm256_mul_ps(ay, dt));
+        vz = _mm256_add_ps(vz, _mm256_mul_ps(az, dt));
+
+        // Stop threshold
+        vx = _mm256_andnot_ps(_mm256_cmp_ps(_mm256_andnot_ps(signBit, vx), stop, _CMP_LT_OQ), vx);
+        vy = _mm256_andnot_ps(_mm256_cmp_ps(_mm256_andnot_ps(signBit, vy), stop, _CMP_LT_OQ), vy);
+
+        // Sleeping balls have no velocity nor acceleration, only the acceleration
+        // must be kept as is (0 * -friction would give -0)
+        __m256 f = _mm256_mul_ps(negFriction, _mm256_loadu_ps(&s.invMass[i]));
+        ax = _mm256_blendv_ps(_mm256_mul_ps(vx, f), ax, sleeping);
+        ay = _mm256_blendv_ps(_mm256_mul_ps(vy, f), ay, sleeping);
+        az = _mm256_blendv_ps(_mm256_mul_ps(vz, f), az, sleeping);
+
+        x = _mm256_add_ps(x, _mm256_mul_ps(vx, dt));
+        y = _mm256_add_ps(y, _mm256_mul_ps(vy, dt));
+        z = _mm256_add_ps(z, _mm256_mul_ps(vz, dt));
+
+        // Balls on the table stay at z = 0
+        __m256 onTable = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(flags, pocketFlag), zero));
+        z = _mm256_andnot_ps(onTable, z);
+        vz = _mm256_andnot_ps(onTable, vz);
+        az = _mm256_andnot_ps(onTable, az);
+
+        _mm256_storeu_ps(&s.x[i], x); _mm256_storeu_ps(&s.y[i], y); _mm256_storeu_ps(&s.z[i], z);
+        _mm256_storeu_ps(&s.vx[i], vx); _mm256_storeu_ps(&s.vy[i], vy); _mm256_storeu_ps(&s.vz[i], vz);
+        _mm256_storeu_ps(&s.ax[i], ax); _mm256_storeu_ps(&s.ay[i], ay); _mm256_storeu_ps(&s.az[i], az);
+    }
+
+    integrateBallsScalar(s, i, end, deltaTime, friction, stopThreshold);
+}
+
+inline bool cpuSupportsAVX2() {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+
+    // The OS must save the YMM registers (OSXSAVE + AVX, then XCR0)
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) return false;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+inline IntegrateKernel selectIntegrateKernel() {
+#ifdef POOL_SIMD_X86
+    if (cpuSupportsAVX2()) return integrateBallsAVX2;
+#endif
+#ifdef POOL_SIMD_SSE2
+    return integrateBallsSSE2;
+#else
+    return integrateBallsScalar<float>;
+#endif
+}
+
+// Kernel used by integrateBalls, chosen once for the running CPU
+inline IntegrateKernel integrateKernel() {
+    static const IntegrateKernel kernel = selectIntegrateKernel();
+    return kernel;
+}
+
+#endif /* INTEGRATOR_H */
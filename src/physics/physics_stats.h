@@ -0,0 +1,176 @@
+#ifndef PHYSICS_STATS_H
+#define PHYSICS_STATS_H
+
+// Counters of the work done by the physics : pairs tested, contacts resolved, contact
+// islands, rail hits, pocket checks, steps per update and time per phase of the step.
+// The simulation thread adds to them and any thread can poll them without locking
+// (an overlay, a CSV dump). Every counter is exact, but a snapshot taken during a step
+// can mix counters from before and after it.
+//
+// Build with POOL_NO_STATS (cmake -DPOOL_PHYSICS_STATS=OFF) to compile the counting
+// out of the physics : the step then takes no time nor counter, and the snapshots are zero.
+
+#include <atomic>
+#include <chrono>
+#include <ostream>
+#include <cstdint>
+
+
+#ifndef POOL_NO_STATS
+#define POOL_STATS
+#endif
+
+// Statement only compiled with the stats
+#ifdef POOL_STATS
+#define POOL_STAT(statement) statement
+#else
+#define POOL_STAT(statement)
+#endif
+
+
+enum PhysicsPhase {
+    PHASE_INTEGRATE = 0,
+    PHASE_BROADPHASE,
+    PHASE_NARROWPHASE,   // Collision tests and responses
+    PHASE_TABLE,         // Rails and pockets
+    PHASE_COUNT
+};
+
+// Counters of one step, kept by the thread running it
+struct StepCounters {
+    int pairsTested = 0;
+    int contacts = 0;
+    int islands = 0;
+    int railHits = 0;
+    int pocketChecks = 0;
+    uint64_t phaseNanoseconds[PHASE_COUNT] = {};
+};
+
+// Values of the counters at one time. Subtract two snapshots to get the work between them
+struct PhysicsStatsSnapshot {
+    uint64_t updates = 0;
+    uint64_t steps = 0;
+    uint64_t pairsTested = 0;
+    uint64_t contacts = 0;
+    uint64_t islands = 0;
+    uint64_t railHits = 0;
+    uint64_t pocketChecks = 0;
+    uint64_t phaseNanoseconds[PHASE_COUNT] = {};
+
+    PhysicsStatsSnapshot operator-(const PhysicsStatsSnapshot& previous) const {
+        PhysicsStatsSnapshot delta;
+        delta.updates = updates - previous.updates;
+        delta.steps = steps - previous.steps;
+        delta.pairsTested = pairsTested - previous.pairsTested;
+        delta.contacts = contacts - previous.contacts;
+        delta.islands = islands - previous.islands;
+        delta.railHits = railHits - previous.railHits;
+        delta.pocketChecks = pocketChecks - previous.pocketChecks;
+        for (int p = 0; p < PHASE_COUNT; p++) {
+            delta.phaseNanoseconds[p] = phaseNanoseconds[p] - previous.phaseNanoseconds[p];
+        }
+        return delta;
+    }
+
+    uint64_t totalNanoseconds() const {
+        uint64_t total = 0;
+        for (int p = 0; p < PHASE_COUNT; p++) {
+            total += phaseNanoseconds[p];
+        }
+        return total;
+    }
+
+    static void writeCsvHeader(std::ostream& out) {
+        out << "time,updates,steps,pairs_tested,contacts,islands,rail_hits,pocket_checks,"
+            << "integrate_us,broadphase_us,narrowphase_us,table_us\n";
+    }
+
+    // time : seconds, first column. One row per frame, so the stream is not flushed
+    void writeCsvRow(std::ostream& out, double time) const {
+        out << time << "," << updates << "," << steps << "," << pairsTested << "," << contacts << ","
+            << islands << "," << railHits << "," << pocketChecks;
+        for (int p = 0; p < PHASE_COUNT; p++) {
+            out << "," << phaseNanoseconds[p] * 1e-3;
+        }
+        out << "\n";
+    }
+};
+
+
+class PhysicsStats
+{
+public:
+#ifdef POOL_STATS
+    static const bool enabled = true;
+#else
+    static const bool enabled = false;
+#endif
+
+    // Writer : one thread at a time
+    void addStep(const StepCounters& counters) {
+        add(steps, 1);
+        add(pairsTested, counters.pairsTested);
+        add(contacts, counters.contacts);
+        add(islands, counters.islands);
+        add(railHits, counters.railHits);
+        add(pocketChecks, counters.pocketChecks);
+        for (int p = 0; p < PHASE_COUNT; p++) {
+            add(phaseNanoseconds[p], counters.phaseNanoseconds[p]);
+        }
+    }
+
+    void addUpdate() {
+        add(updates, 1);
+    }
+
+    // Reader : any thread
+    PhysicsStatsSnapshot snapshot() const {
+        PhysicsStatsSnapshot s;
+        s.updates = updates.load(std::memory_order_relaxed);
+        s.steps = steps.load(std::memory_order_relaxed);
+        s.pairsTested = pairsTested.load(std::memory_order_relaxed);
+        s.contacts = contacts.load(std::memory_order_relaxed);
+        s.islands = islands.load(std::memory_order_relaxed);
+        s.railHits = railHits.load(std::memory_order_relaxed);
+        s.pocketChecks = pocketChecks.load(std::memory_order_relaxed);
+        for (int p = 0; p < PHASE_COUNT; p++) {
+            s.phaseNanoseconds[p] = phaseNanoseconds[p].load(std::memory_order_relaxed);
+        }
+        return s;
+    }
+
+private:
+    std::atomic<uint64_t> updates{0};
+    std::atomic<uint64_t> steps{0};
+    std::atomic<uint64_t> pairsTested{0};
+    std::atomic<uint64_t> contacts{0};
+    std::atomic<uint64_t> islands{0};
+    std::atomic<uint64_t> railHits{0};
+    std::atomic<uint64_t> pocketChecks{0};
+    std::atomic<uint64_t> phaseNanoseconds[PHASE_COUNT] = {};
+
+    // Single writer : a load and a store, no locked read-modify-write
+    static void add(std::atomic<uint64_t>& counter, uint64_t value) {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+};
+
+
+// Measures the phases of a step one after the other
+class PhaseTimer
+{
+public:
+    PhaseTimer() : last(std::chrono::steady_clock::now()) {}
+
+    // End of phase : add the time since the end of the previous one
+    void end(PhysicsPhase phase, StepCounters& counters) {
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        counters.phaseNanoseconds[phase] += std::chrono::duration_cast<std::chrono::nanoseconds>(now - last).count();
+        last = now;
+    }
+
+private:
+    std::chrono::steady_clock::time_point last;
+};
+
+#endif /* PHYSICS_STATS_H */
@@ -0,0 +1,316 @@
+#include "pool_simulation.h"
+
+#include <random>
+#include <algorithm>
+
+
+template<typename Real>
+BasicPoolSimulation<Real>::BasicPoolSimulation(int ballCount) :
+    scratch(maxX, maxY),
+    eventSimulation(maxX, maxY)
+{
+    for (int i = 0; i < ballCount; i++) {
+        balls.add(RADIUS, MASS);
+    }
+
+    setupPockets();
+    resetGame();
+}
+
+template<typename Real>
+float BasicPoolSimulation<Real>::update(double deltaTime, BasicStepScratch<Real>& scratch) {
+    POOL_STAT(if (stats) stats->addUpdate());
+    if (deterministic) return updateDeterministic(deltaTime, scratch);
+
+    float alpha = 1.0f;
+
+    if (balls.allSleeping()) {
+        // Nothing moves (usually between two shots)
+        accumulator = 0.0;
+    }
+    else if (eventDriven) {
+        eventSimulation.advance(balls, deltaTime);
+        // The engine has no spin. A frame is too long for the first order orientation
+        // update : it turns the balls in steps of timeStep
+        for (double t = deltaTime; t > 0.0; t -= timeStep) {
+            rollBalls(balls, RealStep<Real>((float)glm::min(t, (double)timeStep)), true);
+        }
+        updateSleeping(balls);
+    }
+    else if (fixedStep) {
+        accumulator += deltaTime;
+
+        int substeps = 0;
+        while (accumulator >= timeStep && substeps < maxSubsteps) {
+            step(timeStep, scratch);
+            accumulator -= timeStep;
+            substeps++;
+        }
+
+        // Too far behind (hitch) : drop the remaining time instead of catching up
+        if (accumulator >= timeStep) accumulator = 0.0;
+
+        alpha = (float)(accumulator / timeStep);
+    }
+    else {
+        step((float)deltaTime, scratch);
+    }
+
+    updateCue((float)deltaTime);
+
+    return alpha;
+}
+
+template<typename Real>
+float BasicPoolSimulation<Real>::updateDeterministic(double deltaTime, BasicStepScratch<Real>& scratch) {
+    // Same as the fixed step, but the steps are taken even when the balls are asleep
+    // so that the shot lands on the same step whatever the frame rate
+    accumulator += deltaTime;
+
+    int substeps = 0;
+    while (accumulator >= timeStep && substeps < maxSubsteps) {
+        updateCue(timeStep);
+        step(timeStep, scratch);
+        accumulator -= timeStep;
+        substeps++;
+    }
+
+    if (accumulator >= timeStep) accumulator = 0.0;
+
+    return (float)(accumulator / timeStep);
+}
+
+template<typename Real>
+void BasicPoolSimulation<Real>::stepDeterministic() {
+    updateCue(timeStep);
+    step(timeStep, scratch);
+}
+
+template<typename Real>
+void BasicPoolSimulation<Real>::updateCue(float deltaTime) {
+    if (cue.update(deltaTime, balls.position(0))) {
+        impulseBall(balls, 0, cue.force, cue.azimuthal);
+        stateChanged();
+    }
+}
+
+template<typename Real>
+void BasicPoolSimulation<Real>::step(float deltaTime, BasicStepScratch<Real>& scratch) {
+    // Reported with the stats only (see physics_stats.h)
+    StepCounters counters;
+    POOL_STAT(PhaseTimer timer);
+
+    if (phaseMotion) integrateBallMotion(balls, RealStep<Real>(deltaTime));
+    else integrateBalls(balls, RealStep<Real>(deltaTime));
+    POOL_STAT(timer.end(PHASE_INTEGRATE, counters));
+
+    std::vector<BallPair>& pairs = scratch.pairs;
+    scratch.broadphase->sleepingPairs = contactIterations > 1;
+    scratch.broadphase->findPairs(balls, pairs);
+    if (deterministic) sortPairs(pairs);
+    POOL_STAT(timer.end(PHASE_BROADPHASE, counters));
+
+    counters.contacts = scratch.islands.solve(balls, pairs, contactIterations, contactPool);
+    POOL_STAT(counters.islands = scratch.islands.size());
+    POOL_STAT(counters.pairsTested = (int)pairs.size());
+    POOL_STAT(timer.end(PHASE_NARROWPHASE, counters));
+
+    if (!geometry.builtFor(pockets, maxX, maxY)) geometry.build(pockets, maxX, maxY);
+    for (int i = 0; i < balls.size(); i++) {
+        checkTable(balls, i, geometry, &counters);
+    }
+    POOL_STAT(timer.end(PHASE_TABLE, counters));
+
+    rollBalls(balls, RealStep<Real>(deltaTime), !phaseMotion);
+    updateSleeping(balls);
+    stepCount++;
+    POOL_STAT(if (stats) stats->addStep(counters));
+
+    if (deterministic) {
+        stateHash = hashBallState(balls);
+        if (onStep) onStep(stepCount, stateHash);
+    }
+}
+
+template<typename Real>
+void BasicPoolSimulation<Real>::resetGame() {
+    setupBalls();
+    stepCount = 0;
+    stateHash = hashBallState(balls);
+    stateChanged();
+}
+
+template<typename Real>
+void BasicPoolSimulation<Real>::resetCueBall() {
+    balls.reset(0, 0.0f, COORD_RES.x * 0.25f);
+    stateChanged();
+}
+
+template<typename Real>
+void BasicPoolSimulation<Real>::applyInput(const TableInput& input) {
+    switch (input.type) {
+        case TABLE_TURN_CUE: turnCue((int)input.value, input.time); break;
+        case TABLE_MOVE_CUE: moveCue((int)input.value, input.time); break;
+        case TABLE_SHOOT_CUE: shootCue(); break;
+        case TABLE_SWITCH_CUE: switchCueState(); break;
+        case TABLE_AIM_CUE: cue.aim(input.value, input.time); break;
+        case TABLE_RESET_GAME: resetGame(); break;
+        case TABLE_RESET_CUE_BALL: resetCueBall(); break;
+        case TABLE_SWITCH_MOTION_MODEL: switchMotionModel(); break;
+        default: break;
+    }
+}
+
+template<typename Real>
+bool BasicPoolSimulation<Real>::saveSnapshot(BasicTableSnapshot<Real>& snapshot) const {
+    if (!saveBalls(balls, snapshot)) return false;
+
+    snapshot.cue = cue;
+    snapshot.accumulator = accumulator;
+    snapshot.stepCount = stepCount;
+    snapshot.stateHash = stateHash;
+    return true;
+}
+
+template<typename Real>
+bool BasicPoolSimulation<Real>::restoreSnapshot(const BasicTableSnapshot<Real>& snapshot) {
+    if (!restoreBalls(balls, snapshot)) return false;
+
+    cue = snapshot.cue;
+    accumulator = snapshot.accumulator;
+    stepCount = snapshot.stepCount;
+    stateHash = snapshot.stateHash;
+    stateChanged();
+    return true;
+}
+
+template<typename Real>
+void BasicPoolSimulation<Real>::setupSandbox(int count, uint32_t seed) {
+    sandbox = true;
+    sandboxSeed = seed;
+
+    float scale = glm::sqrt(glm::max(1.0f, count / (float)BALL_COUNT));
+    maxX = COORD_RES.z * 0.5f * scale;
+    maxY = COORD_RES.x * 0.5f * scale;
+    pockets.clear();
+    scratch = BasicStepScratch<Real>(maxX, maxY);
+    eventSimulation = EventSimulation(maxX, maxY);
+
+    balls = BasicBallState<Real>();
+    for (int i = 0; i < count; i++) {
+        balls.add(RADIUS, MASS);
+    }
+
+    resetGame();
+}
+
+template<typename Real>
+void BasicPoolSimulation<Real>::switchPhysicsMode() {
+    // The event-driven engine advances by the frame time, it is not deterministic
+    if (deterministic) return;
+
+    eventDriven = !eventDriven;
+    accumulator = 0.0;
+    clearSpin(balls);
+    stateChanged();
+}
+
+template<typename Real>
+void BasicPoolSimulation<Real>::switchMotionModel() {
+    phaseMotion = !phaseMotion;
+    clearSpin(balls);
+}
+
+template<typename Real>
+void BasicPoolSimulation<Real>::setDeterministic(bool enable) {
+    deterministic = enable;
+    eventDriven = false;
+    accumulator = 0.0;
+    stepCount = 0;
+    stateHash = hashBallState(balls);
+}
+
+template<typename Real>
+void BasicPoolSimulation<Real>::stateChanged() {
+    if (eventDriven) eventSimulation.start(balls, pockets);
+}
+
+template<typename Real>
+void BasicPoolSimulation<Real>::setupBalls() {
+    if (sandbox) {
+        scatterBalls();
+        return;
+    }
+    if (balls.size() != BALL_COUNT) return;
+
+    // Place balls in triangle
+    const float maxX = COORD_RES.x * 0.5f;
+    const float r = RADIUS + 0.1f;
+    const float h = glm::sqrt(3.0f) * r;
+    int indexes[15]  = {9, 7, 12, 15, 8, 1, 6, 10, 3, 14, 11, 2, 13, 4, 5};
+    int length = 1;
+    int number = 1;
+    
+    // The racked balls show their number on top
+    const glm::quat rackOrientation = glm::angleAxis(glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+    resetCueBall();
+    glm::vec3 current = glm::vec3(0.0f, -maxX * 0.5f, 0.0f);
+    
+    for (int i=0; i<15; i++) {
+        int index = indexes[i];
+
+        balls.reset(index, current.x, current.y);
+        balls.setOrientation(index, rackOrientation);
+
+        if (number < length) {
+            current.x = current.x + r*2;
+            number++;
+        }
+        else {
+            current.y = current.y - h;
+            current.x = current.x - r*(2*length-1);
+
+            length++;
+            number = 1;
+        }
+    }
+}
+
+// Random cells of a grid of the size of a ball, so that no ball overlaps another
+template<typename Real>
+void BasicPoolSimulation<Real>::scatterBalls() {
+    std::mt19937 rng(sandboxSeed);
+    float cell = 2.0f * RADIUS + 0.1f;
+    int cellsX = (int)(2.0f * maxX / cell);
+    int cellsY = (int)(2.0f * maxY / cell);
+
+    std::vector<int> cells(cellsX * cellsY);
+    for (int c = 0; c < (int)cells.size(); c++) {
+        cells[c] = c;
+    }
+    std::shuffle(cells.begin(), cells.end(), rng);
+
+    std::uniform_real_distribution<float> randSpeed(-SANDBOX_SPEED, SANDBOX_SPEED);
+    for (int i = 0; i < balls.size() && i < (int)cells.size(); i++) {
+        float x = -maxX + cell * (cells[i] % cellsX + 0.5f);
+        float y = -maxY + cell * (cells[i] / cellsX + 0.5f);
+        balls.reset(i, x, y);
+        balls.vx[i] = Real(randSpeed(rng));
+        balls.vy[i] = Real(randSpeed(rng));
+    }
+}
+
+template<typename Real>
+void BasicPoolSimulation<Real>::setupPockets() {
+    pockets.push_back(PoolPocket(-POCKET_X, 0.0f, 0.0f));
+    pockets.push_back(PoolPocket(-POCKET_X2, -POCKET_Y, 45.0f));
+    pockets.push_back(PoolPocket(POCKET_X2, -POCKET_Y, 135.0f));
+    pockets.push_back(PoolPocket(POCKET_X, 0.0f, 180.0f));
+    pockets.push_back(PoolPocket(POCKET_X2, POCKET_Y, -135.0f));
+    pockets.push_back(PoolPocket(-POCKET_X2, POCKET_Y, -45.0f));
+}
+
+template class BasicPoolSimulation<float>;
+template class BasicPoolSimulation<double>;
+template class BasicPoolSimulation<Fixed32>;
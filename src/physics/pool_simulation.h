@@ -0,0 +1,185 @@
+#ifndef POOL_SIMULATION_H
+#define POOL_SIMULATION_H
+
+// Headless simulation of a pool table : balls, pockets, rails and cue.
+// Nothing here depends on OpenGL or GLFW, the renderer (PoolGame) only reads the state.
+
+#include <vector>
+#include <memory>
+#include <functional>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "ball_state.h"
+#include "ball_physics.h"
+#include "ball_motion.h"
+#include "cue_state.h"
+#include "broadphase.h"
+#include "contact_islands.h"
+#include "event_simulation.h"
+#include "state_hash.h"
+#include "table_snapshot.h"
+#include "table_input.h"
+#include "physics_stats.h"
+
+
+// Table coordinates : x is the length, y the height and z the width of the table
+const glm::vec3 COORD_RES = glm::vec3(200.0f, 100.0f, 100.0f);
+
+const float FIXED_TIME_STEP = 1.0f / 480.0f;
+const int MAX_SUBSTEPS = 48;  // At 480 Hz, frames longer than 100 ms are slowed down instead of simulated
+
+const int BALL_COUNT = 16;
+
+const float SANDBOX_SPEED = 150.0f;   // Maximum initial speed along each axis of a sandbox ball
+const uint32_t SANDBOX_SEED = 42;
+
+// Cell of the grid broadphase : the 3x3 cells around a ball hold every ball closer than
+// CONTACT_MARGIN to it, the pairs that join the contact islands
+const float BROADPHASE_CELL_SIZE = 2.0f * RADIUS + CONTACT_MARGIN;
+
+
+// Temporary buffers of a physics step (collision candidates, islands). They hold nothing
+// between two steps, so tables stepped on the same thread can share one
+template<typename Real>
+struct BasicStepScratch {
+    std::unique_ptr<BasicBroadphase<Real>> broadphase;
+    std::vector<BallPair> pairs;
+    ContactIslands islands;
+
+    BasicStepScratch(float maxX = COORD_RES.z * 0.5f, float maxY = COORD_RES.x * 0.5f) :
+        broadphase(new BasicGridBroadphase<Real>(maxX, maxY, BROADPHASE_CELL_SIZE))
+    {}
+};
+
+typedef BasicStepScratch<float> StepScratch;
+
+
+// Real is the precision of the physics (float, double or Fixed32, see precision.h).
+// The member functions are instantiated for the three of them in pool_simulation.cpp
+template<typename Real>
+class BasicPoolSimulation
+{
+public:
+    BasicBallState<Real> balls;
+    std::vector<PoolPocket> pockets;
+    CueState cue;
+
+    // Built from pockets, maxX and maxY before the steps that follow a change of one of them
+    BasicTableGeometry<Real> geometry;
+
+    // Half extents of the playing area (balls move in x across the width, in y along the length)
+    float maxX = COORD_RES.z * 0.5f;
+    float maxY = COORD_RES.x * 0.5f;
+
+    // Sandbox (see setupSandbox) : resetGame scatters the balls again from sandboxSeed
+    bool sandbox = false;
+    uint32_t sandboxSeed = SANDBOX_SEED;
+
+    // Contacts : passes of the solver over every island, and the workers solving the
+    // islands of the large steps (not owned, null : on the thread of the step)
+    int contactIterations = CONTACT_ITERATIONS;
+    ThreadPool* contactPool = nullptr;
+
+    // Used when no scratch is given to update
+    BasicStepScratch<Real> scratch;
+
+    // Fixed-step simulation : the frame time is accumulated and consumed in steps of timeStep
+    bool fixedStep = true;
+    float timeStep = FIXED_TIME_STEP;
+    int maxSubsteps = MAX_SUBSTEPS;
+    double accumulator = 0.0;
+
+    // Ball motion of the fixed steps : sliding, rolling and spinning phases in closed form
+    // (see ball_motion.h) instead of the friction proportional to the velocity.
+    // The event-driven engine keeps the friction proportional to the velocity
+    bool phaseMotion = false;
+
+    // Event-driven simulation : jumps from one collision to the next instead of stepping
+    bool eventDriven = false;
+    EventSimulation eventSimulation;
+
+    // Deterministic simulation : always fixed steps, the cue is updated inside the steps
+    // and the pairs are handled in a fixed order, so that the same inputs give the
+    // same states on every run. The state is hashed after every step
+    bool deterministic = false;
+    uint64_t stepCount = 0;   // Steps since the last reset (counted in every mode)
+    uint64_t stateHash = 0;
+    // Called after every deterministic step with the step number and the state hash
+    std::function<void(uint64_t, uint64_t)> onStep;
+
+    // Counters of the steps, not owned. Null : nothing is counted (planner simulations)
+    PhysicsStats* stats = nullptr;
+
+    BasicPoolSimulation(int ballCount = BALL_COUNT);
+
+    // Advance the simulation by the frame time.
+    // Return the interpolation factor between the two last physics steps (1 = latest state)
+    float update(double deltaTime) {
+        return update(deltaTime, scratch);
+    }
+
+    // Same, with the temporary buffers of the calling thread
+    float update(double deltaTime, BasicStepScratch<Real>& scratch);
+
+    // Advance the physics of the balls by deltaTime
+    void step(float deltaTime) {
+        step(deltaTime, scratch);
+    }
+
+    void step(float deltaTime, BasicStepScratch<Real>& scratch);
+
+    // One step of the deterministic simulation, cue included, for the callers that count
+    // the steps themselves (see RollbackSession)
+    void stepDeterministic();
+
+    void resetGame();
+    void resetCueBall();
+
+    // Copy of the balls, the cue and the step counters, without allocation (see table_snapshot.h).
+    // Return false if the table has more balls than a snapshot, or not the balls of the snapshot
+    bool saveSnapshot(BasicTableSnapshot<Real>& snapshot) const;
+    bool restoreSnapshot(const BasicTableSnapshot<Real>& snapshot);
+
+    // Scaling tests : count balls at random positions with random velocities, on a table
+    // scaled to keep the density of a 16 balls table, without pockets
+    void setupSandbox(int count, uint32_t seed = SANDBOX_SEED);
+    void switchPhysicsMode();
+    void switchMotionModel();
+    void setDeterministic(bool enable);
+
+    // The balls were moved from outside the simulation
+    void stateChanged();
+
+    void turnCue(int direction, float deltaTime) {
+        cue.turn(direction, deltaTime);
+    }
+    
+    void moveCue(int direction, float deltaTime) {
+        cue.changeDistance(direction, deltaTime);
+    }
+
+    void shootCue() {
+        cue.shoot();
+    }
+
+    void switchCueState() {
+        cue.switchEnable();
+    }
+
+    // One of the commands above, or a reset (see table_input.h)
+    void applyInput(const TableInput& input);
+
+private:
+    float updateDeterministic(double deltaTime, BasicStepScratch<Real>& scratch);
+    void updateCue(float deltaTime);
+
+    void setupBalls();
+    void scatterBalls();
+    void setupPockets();
+};
+
+typedef BasicPoolSimulation<float> PoolSimulation;
+
+#endif /* POOL_SIMULATION_H */
@@ -0,0 +1,163 @@
+#ifndef PRECISION_H
+#define PRECISION_H
+
+// Number types the physics can be instantiated with (the Real template parameter) :
+//   float   : fast, used by the game and the batch searches
+//   double  : reference to validate the float results against
+//   Fixed32 : 32-bit fixed point. Its operators are integer operations, and the steps
+//             of the velocity friction model only use them, besides the exact float
+//             conversions that pick the grid cells : from a given state, these steps
+//             give the same results on every compiler and CPU. The inputs still come
+//             from floats : the cue impulse goes through the sin and cos of the C
+//             library, which may differ between platforms, and the phase motion model
+//             (ball_motion.h) computes in double. Only the steps between two shots are
+//             reproducible across platforms.
+// The physics code only uses the operators below and realSqrt/realAbs, writes its
+// constants as Real(x) and multiplies by the time step as a RealStep<Real>.
+
+#include <cstdint>
+#include <cmath>
+#include <limits>
+
+
+// Signed fixed point number with FRACTION_BITS fraction bits stored in 32 bits.
+// Q17.14 : range of +-131072 with a resolution of 6.1e-5, enough for squared
+// distances across the table and for the per-step velocity changes at 480 Hz.
+// Products and quotients are computed in 64 bits and rounded toward -infinity.
+class Fixed32
+{
+public:
+    static const int FRACTION_BITS = 14;
+    static const int32_t ONE = 1 << FRACTION_BITS;
+
+    int32_t raw = 0;
+
+    Fixed32() {}
+    explicit Fixed32(int v) : raw(v * ONE) {}
+    explicit Fixed32(float v) : raw((int32_t)std::lround((double)v * ONE)) {}
+    explicit Fixed32(double v) : raw((int32_t)std::lround(v * ONE)) {}
+
+    static Fixed32 fromRaw(int32_t raw) {
+        Fixed32 f;
+        f.raw = raw;
+        return f;
+    }
+
+    explicit operator float() const {
+        return (float)raw / ONE;
+    }
+
+    explicit operator double() const {
+        return (double)raw / ONE;
+    }
+
+    Fixed32 operator-() const { return fromRaw(-raw); }
+
+    Fixed32 operator+(Fixed32 b) const { return fromRaw(raw + b.raw); }
+    Fixed32 operator-(Fixed32 b) const { return fromRaw(raw - b.raw); }
+    Fixed32 operator*(Fixed32 b) const { return fromRaw((int32_t)(((int64_t)raw * b.raw) >> FRACTION_BITS)); }
+    Fixed32 operator/(Fixed32 b) const { return fromRaw((int32_t)(((int64_t)raw * ONE) / b.raw)); }
+
+    Fixed32& operator+=(Fixed32 b) { raw += b.raw; return *this; }
+    Fixed32& operator-=(Fixed32 b) { raw -= b.raw; return *this; }
+    Fixed32& operator*=(Fixed32 b) { return *this = *this * b; }
+    Fixed32& operator/=(Fixed32 b) { return *this = *this / b; }
+
+    bool operator==(Fixed32 b) const { return raw == b.raw; }
+    bool operator!=(Fixed32 b) const { return raw != b.raw; }
+    bool operator<(Fixed32 b) const { return raw < b.raw; }
+    bool operator<=(Fixed32 b) const { return raw <= b.raw; }
+    bool operator>(Fixed32 b) const { return raw > b.raw; }
+    bool operator>=(Fixed32 b) const { return raw >= b.raw; }
+};
+
+
+// Factor in [-2, 2) with 30 fraction bits, for the products by the time step : 1/480 s
+// is 34/16384 in Q17.14 (0.4% off), 2236962/2^30 here (6e-8 off). The products are
+// rounded to the nearest, a rounding toward -infinity at every step drifts the balls
+class FixedStep
+{
+public:
+    static const int FRACTION_BITS = 30;
+
+    int32_t raw = 0;
+
+    FixedStep() {}
+    explicit FixedStep(float v) : raw((int32_t)std::llround((double)v * (1 << FRACTION_BITS))) {}
+
+    explicit operator double() const {
+        return (double)raw / (1 << FRACTION_BITS);
+    }
+};
+
+inline Fixed32 operator*(Fixed32 a, FixedStep b) {
+    return Fixed32::fromRaw((int32_t)(((int64_t)a.raw * b.raw + (1 << (FixedStep::FRACTION_BITS - 1))) >> FixedStep::FRACTION_BITS));
+}
+
+// Type of the time step of a precision : Real itself, FixedStep for Fixed32
+template<typename Real> struct StepType { typedef Real Type; };
+template<> struct StepType<Fixed32> { typedef FixedStep Type; };
+
+template<typename Real>
+using RealStep = typename StepType<Real>::Type;
+
+
+inline float realSqrt(float v) { return std::sqrt(v); }
+inline double realSqrt(double v) { return std::sqrt(v); }
+
+// Integer square root of the raw value shifted by FRACTION_BITS (bit by bit, exact)
+inline Fixed32 realSqrt(Fixed32 v) {
+    if (v.raw <= 0) return Fixed32();
+
+    uint64_t n = (uint64_t)v.raw << Fixed32::FRACTION_BITS;
+    uint64_t root = 0;
+    uint64_t bit = (uint64_t)1 << 62;
+    while (bit > n) bit >>= 2;
+
+    while (bit != 0) {
+        if (n >= root + bit) {
+            n -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return Fixed32::fromRaw((int32_t)root);
+}
+
+inline float realAbs(float v) { return std::abs(v); }
+inline double realAbs(double v) { return std::abs(v); }
+inline Fixed32 realAbs(Fixed32 v) { return v.raw < 0 ? -v : v; }
+
+template<typename Real>
+inline float toFloat(Real v) {
+    return (float)v;
+}
+
+template<typename Real>
+inline double toDouble(Real v) {
+    return (double)v;
+}
+
+
+// Compile-time description of a precision
+template<typename Real> struct Precision;
+
+template<> struct Precision<float> {
+    static const char* name() { return "float"; }
+    static float epsilon() { return std::numeric_limits<float>::epsilon(); }
+};
+
+template<> struct Precision<double> {
+    static const char* name() { return "double"; }
+    static double epsilon() { return std::numeric_limits<double>::epsilon(); }
+};
+
+template<> struct Precision<Fixed32> {
+    static const char* name() { return "fixed32"; }
+    static Fixed32 epsilon() { return Fixed32::fromRaw(1); }
+};
+
+#endif /* PRECISION_H */
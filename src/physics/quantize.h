@@ -0,0 +1,17 @@
+#ifndef QUANTIZE_H
+#define QUANTIZE_H
+
+// Quantization of a float to an integer number of steps, rounded to the nearest (halves
+// upward). Shared by the replays and the shot cache, so that a value falls in the same
+// cell in both.
+
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+
+inline int32_t quantize(float value, float step) {
+    return (int32_t)glm::floor(value / step + 0.5f);
+}
+
+#endif /* QUANTIZE_H */
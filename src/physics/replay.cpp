@@ -0,0 +1,480 @@
+#include "replay.h"
+#include "byte_order.h"
+#include "quantize.h"
+
+#include <chrono>
+#include <iterator>
+#include <algorithm>
+
+
+enum ReplayFrameType : uint8_t {
+    REPLAY_KEYFRAME = 0,
+    REPLAY_DELTA = 1,
+};
+
+// ------------------------------------------------------------------------
+// Byte helpers
+
+// Zigzag : small negative numbers become small positive numbers
+static void writeVarint(std::vector<uint8_t>& out, int32_t value) {
+    uint32_t v = ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+    while (v >= 0x80) {
+        out.push_back((uint8_t)(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back((uint8_t)v);
+}
+
+static bool readVarint(const uint8_t*& data, const uint8_t* end, int32_t& value) {
+    uint32_t v = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (data >= end) return false;
+        uint8_t byte = *data++;
+        v |= (uint32_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            value = (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Unsigned, for the step counts
+static void writeUvarint(std::vector<uint8_t>& out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back((uint8_t)(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back((uint8_t)v);
+}
+
+static bool readUvarint(const uint8_t*& data, const uint8_t* end, uint64_t& value) {
+    uint64_t v = 0;
+    for (int shift = 0; shift < 70; shift += 7) {
+        if (data >= end) return false;
+        uint8_t byte = *data++;
+        v |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            value = v;
+            return true;
+        }
+    }
+    return false;
+}
+
+// ------------------------------------------------------------------------
+// Start of a checked replay, exact : every value is written with all its bits
+
+static void writeStart(std::vector<uint8_t>& out, const ReplayStart& start) {
+    const TableSnapshot& snapshot = start.snapshot;
+    int count = snapshot.ballCount;
+
+    writeValue(out, (uint8_t)start.phaseMotion);
+    writeValue(out, (uint8_t)count);
+    for (int a = 0; a < SNAPSHOT_ARRAYS; a++) {
+        for (int i = 0; i < count; i++) {
+            writeValue(out, snapshot.values[a][i]);
+        }
+    }
+    out.insert(out.end(), snapshot.flags, snapshot.flags + count);
+    for (int i = 0; i < count; i++) {
+        writeValue(out, snapshot.pocket[i]);
+    }
+
+    const CueState& cue = snapshot.cue;
+    for (float value : {cue.Position.x, cue.Position.y, cue.azimuthal, cue.latitude, cue.distance, cue.force,
+                        cue.shootTimer, cue.cooldownTimer, cue.shotDistance}) {
+        writeValue(out, value);
+    }
+    writeValue(out, (uint8_t)cue.enabled);
+    writeValue(out, (uint8_t)cue.takeInput);
+
+    writeValue(out, snapshot.accumulator);
+    writeValue(out, snapshot.stepCount);
+    writeValue(out, snapshot.stateHash);
+}
+
+static bool readStart(const uint8_t*& data, const uint8_t* end, ReplayStart& start) {
+    TableSnapshot& snapshot = start.snapshot;
+    uint8_t phaseMotion, count;
+    if (!readValue(data, end, phaseMotion) || !readValue(data, end, count) || count > SNAPSHOT_MAX_BALLS) return false;
+    start.phaseMotion = phaseMotion != 0;
+    snapshot.ballCount = count;
+
+    for (int a = 0; a < SNAPSHOT_ARRAYS; a++) {
+        for (int i = 0; i < count; i++) {
+            if (!readValue(data, end, snapshot.values[a][i])) return false;
+        }
+    }
+    for (int i = 0; i < count; i++) {
+        if (!readValue(data, end, snapshot.flags[i])) return false;
+    }
+    for (int i = 0; i < count; i++) {
+        if (!readValue(data, end, snapshot.pocket[i])) return false;
+    }
+
+    CueState& cue = snapshot.cue;
+    for (float* value : {&cue.Position.x, &cue.Position.y, &cue.azimuthal, &cue.latitude, &cue.distance, &cue.force,
+                         &cue.shootTimer, &cue.cooldownTimer, &cue.shotDistance}) {
+        if (!readValue(data, end, *value)) return false;
+    }
+    uint8_t enabled, takeInput;
+    if (!readValue(data, end, enabled) || !readValue(data, end, takeInput)) return false;
+    cue.enabled = enabled != 0;
+    cue.takeInput = takeInput != 0;
+
+    return readValue(data, end, snapshot.accumulator)
+        && readValue(data, end, snapshot.stepCount)
+        && readValue(data, end, snapshot.stateHash);
+}
+
+// ------------------------------------------------------------------------
+// Encoder
+
+ReplayEncoder::ReplayEncoder(int ballCount, const ReplayStart* start, int keyframeInterval) :
+    ballCount(ballCount), keyframeInterval(keyframeInterval), checked(start != nullptr)
+{
+    if (start) this->start = *start;
+    previous.balls.assign(ballCount * ReplayQuantized::BALL_VALUES, 0);
+    current.balls.assign(ballCount * ReplayQuantized::BALL_VALUES, 0);
+}
+
+void ReplayEncoder::writeHeader(std::vector<uint8_t>& out) const {
+    uint16_t version = REPLAY_VERSION;
+    uint16_t balls = (uint16_t)ballCount;
+    uint16_t interval = (uint16_t)keyframeInterval;
+    float step = REPLAY_POSITION_STEP;
+
+    writeValue(out, REPLAY_MAGIC);
+    writeValue(out, version);
+    writeValue(out, balls);
+    writeValue(out, interval);
+    writeValue(out, step);
+
+    uint8_t flags = checked ? REPLAY_CHECKED : 0;
+    writeValue(out, flags);
+    if (checked) writeStart(out, start);
+}
+
+void ReplayEncoder::encode(const ReplayFrame& frame, std::vector<uint8_t>& out) {
+    // Quantize
+    for (int i = 0; i < ballCount; i++) {
+        const ReplayBall& ball = frame.balls[i];
+        int32_t* q = &current.balls[i * ReplayQuantized::BALL_VALUES];
+
+        // q and -q are the same rotation : keep w positive so that the deltas stay small
+        glm::quat rotation = ball.rotation.w < 0.0f ? glm::quat(-ball.rotation.w, -ball.rotation.x, -ball.rotation.y, -ball.rotation.z) : ball.rotation;
+
+        q[0] = quantize(ball.position.x, REPLAY_POSITION_STEP);
+        q[1] = quantize(ball.position.y, REPLAY_POSITION_STEP);
+        q[2] = quantize(ball.position.z, REPLAY_POSITION_STEP);
+        q[3] = quantize(rotation.w * REPLAY_ROTATION_SCALE, 1.0f);
+        q[4] = quantize(rotation.x * REPLAY_ROTATION_SCALE, 1.0f);
+        q[5] = quantize(rotation.y * REPLAY_ROTATION_SCALE, 1.0f);
+        q[6] = quantize(rotation.z * REPLAY_ROTATION_SCALE, 1.0f);
+        q[7] = ball.flags;
+    }
+    current.cue[0] = quantize(frame.cue.position.x, REPLAY_POSITION_STEP);
+    current.cue[1] = quantize(frame.cue.position.y, REPLAY_POSITION_STEP);
+    current.cue[2] = quantize(frame.cue.azimuthal, REPLAY_ANGLE_STEP);
+    current.cue[3] = quantize(frame.cue.distance, REPLAY_DISTANCE_STEP);
+    current.cue[4] = frame.cue.enabled ? 1 : 0;
+
+    bool keyframe = frameIndex % keyframeInterval == 0;
+    uint8_t type = keyframe ? REPLAY_KEYFRAME : REPLAY_DELTA;
+    writeValue(out, type);
+    writeValue(out, frame.deltaTime);
+
+    if (keyframe) {
+        for (int32_t value : current.balls) {
+            writeVarint(out, value);
+        }
+        for (int32_t value : current.cue) {
+            writeVarint(out, value);
+        }
+    }
+    else {
+        // Bitmask of the balls that changed
+        std::vector<uint8_t> changed((ballCount + 7) / 8, 0);
+        for (int i = 0; i < ballCount; i++) {
+            int offset = i * ReplayQuantized::BALL_VALUES;
+            if (!std::equal(&current.balls[offset], &current.balls[offset] + ReplayQuantized::BALL_VALUES, &previous.balls[offset])) {
+                changed[i / 8] |= 1 << (i % 8);
+            }
+        }
+        out.insert(out.end(), changed.begin(), changed.end());
+
+        for (int i = 0; i < ballCount; i++) {
+            if (!(changed[i / 8] & (1 << (i % 8)))) continue;
+
+            int offset = i * ReplayQuantized::BALL_VALUES;
+            for (int k = 0; k < ReplayQuantized::BALL_VALUES; k++) {
+                writeVarint(out, current.balls[offset + k] - previous.balls[offset + k]);
+            }
+        }
+
+        bool cueChanged = !std::equal(current.cue, current.cue + ReplayQuantized::CUE_VALUES, previous.cue);
+        out.push_back(cueChanged ? 1 : 0);
+        if (cueChanged) {
+            for (int k = 0; k < ReplayQuantized::CUE_VALUES; k++) {
+                writeVarint(out, current.cue[k] - previous.cue[k]);
+            }
+        }
+    }
+
+    if (checked) {
+        writeUvarint(out, frame.inputs.size());
+        for (const TableInput& input : frame.inputs) {
+            writeValue(out, input.type);
+            writeUvarint(out, input.step);
+            writeValue(out, input.value);
+            writeValue(out, input.time);
+        }
+        if (keyframe) {
+            writeUvarint(out, frame.stepCount);
+            writeValue(out, frame.stateHash);
+        }
+    }
+
+    std::swap(previous, current);
+    frameIndex++;
+}
+
+// ------------------------------------------------------------------------
+// Decoder
+
+bool ReplayDecoder::readHeader(const uint8_t*& data, const uint8_t* end) {
+    uint32_t magic;
+    uint16_t version, balls, interval;
+
+    if (!readValue(data, end, magic) || magic != REPLAY_MAGIC) return false;
+    if (!readValue(data, end, version) || version != REPLAY_VERSION) return false;
+    if (!readValue(data, end, balls)) return false;
+    if (!readValue(data, end, interval)) return false;
+    if (!readValue(data, end, positionStep)) return false;
+
+    uint8_t flags;
+    if (!readValue(data, end, flags)) return false;
+    checked = (flags & REPLAY_CHECKED) != 0;
+    if (checked && !readStart(data, end, start)) return false;
+
+    ballCount = balls;
+    keyframeInterval = interval;
+    state.balls.assign(ballCount * ReplayQuantized::BALL_VALUES, 0);
+    started = false;
+    return true;
+}
+
+bool ReplayDecoder::decode(const uint8_t*& data, const uint8_t* end, ReplayFrame& frame) {
+    uint8_t type;
+    if (!readValue(data, end, type)) return false;
+    if (!readValue(data, end, frame.deltaTime)) return false;
+
+    if (type == REPLAY_KEYFRAME) {
+        for (int32_t& value : state.balls) {
+            if (!readVarint(data, end, value)) return false;
+        }
+        for (int32_t& value : state.cue) {
+            if (!readVarint(data, end, value)) return false;
+        }
+        started = true;
+    }
+    else if (type == REPLAY_DELTA && started) {
+        int maskSize = (ballCount + 7) / 8;
+        if (end - data < maskSize) return false;
+        const uint8_t* changed = data;
+        data += maskSize;
+
+        for (int i = 0; i < ballCount; i++) {
+            if (!(changed[i / 8] & (1 << (i % 8)))) continue;
+
+            for (int k = 0; k < ReplayQuantized::BALL_VALUES; k++) {
+                int32_t delta;
+                if (!readVarint(data, end, delta)) return false;
+                state.balls[i * ReplayQuantized::BALL_VALUES + k] += delta;
+            }
+        }
+
+        uint8_t cueChanged;
+        if (!readValue(data, end, cueChanged)) return false;
+        if (cueChanged) {
+            for (int k = 0; k < ReplayQuantized::CUE_VALUES; k++) {
+                int32_t delta;
+                if (!readVarint(data, end, delta)) return false;
+                state.cue[k] += delta;
+            }
+        }
+    }
+    else {
+        return false;
+    }
+
+    frame.inputs.clear();
+    frame.hashed = false;
+    if (checked) {
+        uint64_t count;
+        if (!readUvarint(data, end, count) || count > (uint64_t)(end - data)) return false;
+        frame.inputs.resize((size_t)count);
+        for (TableInput& input : frame.inputs) {
+            if (!readValue(data, end, input.type) || !readUvarint(data, end, input.step)
+                || !readValue(data, end, input.value) || !readValue(data, end, input.time)) return false;
+        }
+        if (type == REPLAY_KEYFRAME) {
+            if (!readUvarint(data, end, frame.stepCount) || !readValue(data, end, frame.stateHash)) return false;
+            frame.hashed = true;
+        }
+    }
+
+    // Dequantize
+    frame.balls.resize(ballCount);
+    for (int i = 0; i < ballCount; i++) {
+        const int32_t* q = &state.balls[i * ReplayQuantized::BALL_VALUES];
+        ReplayBall& ball = frame.balls[i];
+
+        ball.position = glm::vec3(q[0], q[1], q[2]) * positionStep;
+        ball.rotation = glm::normalize(glm::quat(q[3] / REPLAY_ROTATION_SCALE, q[4] / REPLAY_ROTATION_SCALE,
+                                                 q[5] / REPLAY_ROTATION_SCALE, q[6] / REPLAY_ROTATION_SCALE));
+        ball.flags = (uint8_t)q[7];
+    }
+    frame.cue.position = glm::vec2(state.cue[0], state.cue[1]) * positionStep;
+    frame.cue.azimuthal = state.cue[2] * REPLAY_ANGLE_STEP;
+    frame.cue.distance = state.cue[3] * REPLAY_DISTANCE_STEP;
+    frame.cue.enabled = state.cue[4] != 0;
+    return true;
+}
+
+// ------------------------------------------------------------------------
+// Recorder
+
+ReplayRecorder::ReplayRecorder(const std::string& path, int ballCount, const ReplayStart* start) :
+    file(path, std::ios::binary | std::ios::trunc),
+    encoder(ballCount, start)
+{
+    open = file.is_open();
+    if (!open) return;
+
+    std::vector<uint8_t> header;
+    encoder.writeHeader(header);
+    file.write((const char*)header.data(), header.size());
+    bytesWritten += (long)header.size();
+
+    writer = std::thread(&ReplayRecorder::run, this);
+}
+
+ReplayRecorder::~ReplayRecorder() {
+    stop();
+}
+
+void ReplayRecorder::record(const ReplayFrame& frame) {
+    if (!open) return;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stopping) return;
+        queue.push_back(frame);
+    }
+    recordedTime.store(recordedTime.load() + frame.deltaTime);
+    queued.notify_one();
+}
+
+void ReplayRecorder::stop() {
+    if (!writer.joinable()) return;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    queued.notify_one();
+    writer.join();
+    file.close();
+}
+
+void ReplayRecorder::run() {
+    std::vector<uint8_t> buffer;
+    std::deque<ReplayFrame> frames;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            queued.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (queue.empty() && stopping) break;
+            std::swap(frames, queue);
+        }
+
+        buffer.clear();
+        for (const ReplayFrame& frame : frames) {
+            encoder.encode(frame, buffer);
+        }
+        file.write((const char*)buffer.data(), buffer.size());
+        bytesWritten += (long)buffer.size();
+        framesWritten += (long)frames.size();
+        frames.clear();
+    }
+
+    file.flush();
+}
+
+// ------------------------------------------------------------------------
+// Player
+
+bool ReplayPlayer::open(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return false;
+
+    data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    cursor = data.data();
+    framesDecoded = 0;
+    decodeSeconds = 0.0;
+    duration = 0.0;
+
+    return decoder.readHeader(cursor, data.data() + data.size());
+}
+
+bool ReplayPlayer::next(ReplayFrame& frame) {
+    if (!cursor) return false;
+
+    auto start = std::chrono::steady_clock::now();
+    bool decoded = decoder.decode(cursor, data.data() + data.size(), frame);
+    decodeSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (!decoded) return false;
+    framesDecoded++;
+    duration += frame.deltaTime;
+    return true;
+}
+
+// ------------------------------------------------------------------------
+// Checker
+
+ReplayChecker::ReplayChecker(const ReplayStart& start, int ballCount) :
+    simulation(new PoolSimulation())
+{
+    // Set up as the table of the game (see SimulationThread)
+    if (ballCount != BALL_COUNT) simulation->setupSandbox(ballCount);
+    simulation->setDeterministic(true);
+    simulation->phaseMotion = start.phaseMotion;
+    started = simulation->restoreSnapshot(start.snapshot);
+}
+
+void ReplayChecker::check(const ReplayFrame& frame) {
+    if (!started) return;
+
+    for (const TableInput& input : frame.inputs) {
+        stepTo(input.step);
+        simulation->applyInput(input);
+    }
+    if (!frame.hashed) return;
+
+    stepTo(frame.stepCount);
+    keyframesChecked++;
+    if (simulation->stepCount == frame.stepCount && simulation->stateHash == frame.stateHash) return;
+
+    if (mismatches == 0) firstMismatch = frame.stepCount;
+    mismatches++;
+}
+
+void ReplayChecker::stepTo(uint64_t step) {
+    while (simulation->stepCount < step) {
+        simulation->stepDeterministic();
+    }
+}
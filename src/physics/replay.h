@@ -0,0 +1,239 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+// Binary replays : one frame per rendered frame, with the ball positions and
+// rotations and the cue state.
+//
+// File layout (little endian, see byte_order.h) :
+//   header   : magic "PRPL", u16 version, u16 ball count, u16 keyframe interval, f32 position step,
+//              u8 flags, and for a checked replay the start of the recording (ReplayStart)
+//   frames   : u8 type, f32 frame time, then
+//     keyframe : every ball (position, rotation, flags) and the cue, absolute
+//     delta    : bitmask of the balls that changed, their changes, and the cue if it changed
+//     checked replay : the inputs applied since the previous frame, and on keyframes
+//                the step count and state hash of the simulation
+// Positions, rotations and cue values are quantized to integers, and the deltas are
+// zigzag varints of the difference to the previous frame, so a ball at rest costs
+// nothing and a rolling ball a few bytes. The quantized values are exact, so the
+// deltas do not drift; keyframes only allow to start decoding in the middle of a file.
+// A replay recorded from a deterministic simulation is checked : the table it started
+// from and the inputs of the player are enough to simulate it again, and the state
+// hash of the keyframes tells if the simulation still gives the same steps (see ReplayChecker).
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "pool_simulation.h"
+
+
+const uint32_t REPLAY_MAGIC = 0x4c505250;        // "PRPL"
+const uint16_t REPLAY_VERSION = 2;
+const int REPLAY_KEYFRAME_INTERVAL = 120;         // Frames, 2 s at 60 fps
+const float REPLAY_POSITION_STEP = 1.0f / 1024.0f;  // Table units
+const float REPLAY_ROTATION_SCALE = 32767.0f;     // Quaternion components
+const float REPLAY_ANGLE_STEP = 0.01f;            // Degrees (cue azimuthal)
+const float REPLAY_DISTANCE_STEP = 1.0f / 4096.0f;  // Cue distance
+
+
+struct ReplayBall {
+    glm::vec3 position;
+    glm::quat rotation;
+    uint8_t flags;
+};
+
+struct ReplayCue {
+    glm::vec2 position;
+    float azimuthal;
+    float distance;
+    bool enabled;
+};
+
+struct ReplayFrame {
+    float deltaTime;
+    std::vector<ReplayBall> balls;
+    ReplayCue cue;
+
+    // Checked replays : the inputs applied to the simulation since the previous frame,
+    // and the state of the simulation shown (written on the keyframes only)
+    std::vector<TableInput> inputs;
+    uint64_t stepCount = 0;
+    uint64_t stateHash = 0;
+    bool hashed = false;   // Decoded : stepCount and stateHash were read
+};
+
+enum ReplayFlags : uint8_t {
+    REPLAY_CHECKED = 1 << 0,
+};
+
+// Table a checked replay starts from
+struct ReplayStart {
+    TableSnapshot snapshot;
+    bool phaseMotion = false;
+};
+
+
+// Quantized values of a frame, the state shared by the encoder and the decoder
+struct ReplayQuantized {
+    std::vector<int32_t> balls;   // 8 values per ball : x, y, z, rotation w, x, y, z, flags
+    int32_t cue[5];               // x, y, azimuthal, distance, enabled
+
+    static const int BALL_VALUES = 8;
+    static const int CUE_VALUES = 5;
+};
+
+class ReplayEncoder
+{
+public:
+    // start : null, or the table of a checked replay
+    ReplayEncoder(int ballCount, const ReplayStart* start = nullptr, int keyframeInterval = REPLAY_KEYFRAME_INTERVAL);
+
+    void writeHeader(std::vector<uint8_t>& out) const;
+    void encode(const ReplayFrame& frame, std::vector<uint8_t>& out);
+
+private:
+    int ballCount;
+    int keyframeInterval;
+    bool checked;
+    ReplayStart start;
+    long frameIndex = 0;
+    ReplayQuantized previous;
+    ReplayQuantized current;
+};
+
+class ReplayDecoder
+{
+public:
+    int ballCount = 0;
+    int keyframeInterval = 0;
+    float positionStep = REPLAY_POSITION_STEP;
+    bool checked = false;
+    ReplayStart start;   // Checked replays
+
+    // Return false if the data is not a replay of a supported version
+    bool readHeader(const uint8_t*& data, const uint8_t* end);
+    // Return false at the end of the data or on a truncated frame
+    bool decode(const uint8_t*& data, const uint8_t* end, ReplayFrame& frame);
+
+private:
+    bool started = false;   // A keyframe was read
+    ReplayQuantized state;
+};
+
+
+// Encodes and writes the frames to a file on a background thread,
+// the game thread only copies the frame in a queue
+class ReplayRecorder
+{
+public:
+    std::atomic<long> bytesWritten{0};
+    std::atomic<long> framesWritten{0};
+
+    // start : null, or the table of a checked replay
+    ReplayRecorder(const std::string& path, int ballCount, const ReplayStart* start = nullptr);
+    ~ReplayRecorder();
+
+    bool isOpen() const {
+        return open;
+    }
+
+    void record(const ReplayFrame& frame);
+
+    // Flush the queue and close the file
+    void stop();
+
+    // Size of the replay per second of game
+    double bytesPerSecond() const {
+        double seconds = recordedTime.load();
+        return seconds > 0.0 ? bytesWritten / seconds : 0.0;
+    }
+
+private:
+    std::ofstream file;
+    bool open = false;
+    ReplayEncoder encoder;
+    std::atomic<double> recordedTime{0.0};
+
+    std::thread writer;
+    std::mutex mutex;
+    std::condition_variable queued;
+    std::deque<ReplayFrame> queue;
+    bool stopping = false;
+
+    void run();
+};
+
+
+// Reads a replay file and decodes it frame by frame
+class ReplayPlayer
+{
+public:
+    long framesDecoded = 0;
+    double decodeSeconds = 0.0;   // Time spent decoding
+    double duration = 0.0;        // Game time of the frames decoded
+
+    bool open(const std::string& path);
+    bool next(ReplayFrame& frame);
+
+    int ballCount() const {
+        return decoder.ballCount;
+    }
+
+    // Null if the replay is not checked
+    const ReplayStart* start() const {
+        return decoder.checked ? &decoder.start : nullptr;
+    }
+
+    double framesPerSecondDecoded() const {
+        return decodeSeconds > 0.0 ? framesDecoded / decodeSeconds : 0.0;
+    }
+
+    double bytesPerSecond() const {
+        return duration > 0.0 ? (cursor - data.data()) / duration : 0.0;
+    }
+
+private:
+    std::vector<uint8_t> data;
+    const uint8_t* cursor = nullptr;
+    ReplayDecoder decoder;
+};
+
+
+
+// Simulates a checked replay again : from its start, applies the inputs of every frame
+// at the steps they were recorded at, and compares the state hash of the simulation with
+// the one of every keyframe
+class ReplayChecker
+{
+public:
+    long keyframesChecked = 0;
+    long mismatches = 0;
+    uint64_t firstMismatch = 0;   // Step of the first keyframe that did not match
+
+    ReplayChecker(const ReplayStart& start, int ballCount);
+
+    // False if the start is not a table of ballCount balls
+    bool valid() const {
+        return started;
+    }
+
+    void check(const ReplayFrame& frame);
+
+private:
+    std::unique_ptr<PoolSimulation> simulation;
+    bool started = false;
+
+    void stepTo(uint64_t step);
+};
+
+#endif /* REPLAY_H */
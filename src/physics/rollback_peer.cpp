@@ -0,0 +1,127 @@
+#include "rollback_peer.h"
+#include "byte_order.h"
+
+#include <algorithm>
+
+
+RollbackPeer::RollbackPeer(PoolSimulation& simulation, int localPlayer, const RollbackSettings& settings) :
+    session(simulation, localPlayer),
+    settings(settings),
+    socket((uint16_t)(settings.port + localPlayer)),
+    lossRng(localPlayer + 1)
+{}
+
+void RollbackPeer::hold(CueInput input) {
+    held.turn = input.turn;
+    held.move = input.move;
+    pressed |= input.buttons;
+}
+
+void RollbackPeer::press(CueInput input) {
+    pressed |= input.buttons;
+}
+
+int RollbackPeer::update(double deltaTime) {
+    receivePackets();
+
+    accumulator += deltaTime;
+    sinceSent += deltaTime;
+
+    int ticks = 0;
+    while (accumulator >= ROLLBACK_TICK_TIME && ticks < ROLLBACK_MAX_TICKS_PER_UPDATE) {
+        // The keys held are sampled by every tick, the buttons by the first one
+        CueInput input = held;
+        input.buttons = pressed;
+        if (!session.advance(input)) {
+            // Wait for the other player where we are, instead of catching up afterwards
+            accumulator = 0.0;
+            break;
+        }
+        pressed = 0;
+        accumulator -= ROLLBACK_TICK_TIME;
+        ticks++;
+    }
+    if (accumulator >= ROLLBACK_TICK_TIME) accumulator = 0.0;
+
+    // After every tick, and at the tick rate while waiting so that the acknowledgements go on
+    if (ticks > 0 || sinceSent >= ROLLBACK_TICK_TIME) sendInputs();
+    flushDelayed();
+
+    return ticks;
+}
+
+void RollbackPeer::receivePackets() {
+    uint8_t buffer[512];
+    int size;
+    while ((size = socket.receive(buffer, sizeof(buffer))) >= 0) {
+        const uint8_t* data = buffer;
+        const uint8_t* end = buffer + size;
+
+        uint32_t magic, ack, hashTick, first;
+        uint8_t player, count;
+        uint64_t hash;
+        bool valid = readValue(data, end, magic) && magic == ROLLBACK_MAGIC
+                  && readValue(data, end, player) && player == session.remotePlayer()
+                  && readValue(data, end, ack)
+                  && readValue(data, end, hashTick)
+                  && readValue(data, end, hash)
+                  && readValue(data, end, first)
+                  && readValue(data, end, count)
+                  && (size_t)(end - data) == count * 3u;
+        if (!valid) continue;
+
+        packetsReceived++;
+        remoteAck = std::max(remoteAck, ack);
+        for (int k = 0; k < count; k++) {
+            CueInput input;
+            input.turn = (int8_t)data[3*k];
+            input.move = (int8_t)data[3*k + 1];
+            input.buttons = data[3*k + 2];
+            session.receive(first + k, input);
+        }
+        if (hash) session.checkRemoteHash(hashTick, hash);
+    }
+}
+
+void RollbackPeer::sendInputs() {
+    sinceSent = 0.0;
+
+    uint32_t hashTick = 0;
+    uint64_t hash = 0;
+    if (!session.confirmedHash(hashTick, hash)) hash = 0;
+
+    uint32_t magic = ROLLBACK_MAGIC;
+    uint8_t player = (uint8_t)session.localPlayer();
+    uint32_t ack = session.remoteTicks();
+    uint32_t first = std::min(remoteAck, session.currentTick());
+    uint8_t count = (uint8_t)std::min<uint32_t>(session.currentTick() - first, ROLLBACK_MAX_PACKET_INPUTS);
+
+    packet.clear();
+    writeValue(packet, magic);
+    writeValue(packet, player);
+    writeValue(packet, ack);
+    writeValue(packet, hashTick);
+    writeValue(packet, hash);
+    writeValue(packet, first);
+    writeValue(packet, count);
+    for (uint32_t t = first; t < first + count; t++) {
+        CueInput input = session.localInput(t);
+        packet.push_back((uint8_t)input.turn);
+        packet.push_back((uint8_t)input.move);
+        packet.push_back(input.buttons);
+    }
+
+    if (settings.sendLoss > 0.0f && std::uniform_real_distribution<float>(0.0f, 1.0f)(lossRng) < settings.sendLoss) return;
+    delayed.push_back(DelayedPacket{Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(settings.sendDelay)), packet});
+}
+
+void RollbackPeer::flushDelayed() {
+    Clock::time_point now = Clock::now();
+    uint16_t remotePort = (uint16_t)(settings.port + session.remotePlayer());
+
+    while (!delayed.empty() && delayed.front().time <= now) {
+        const std::vector<uint8_t>& data = delayed.front().data;
+        if (socket.send(remotePort, data.data(), data.size())) packetsSent++;
+        delayed.pop_front();
+    }
+}
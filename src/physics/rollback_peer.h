@@ -0,0 +1,88 @@
+#ifndef ROLLBACK_PEER_H
+#define ROLLBACK_PEER_H
+
+// One player of a rollback match (see rollback_session.h) talking to the other over
+// UDP on the loopback interface. After every tick the peer sends all its inputs the
+// other player did not acknowledge yet, so a lost packet is covered by the next one.
+//
+// Packet (little endian, see byte_order.h) :
+//   u32 magic "PRBK", u8 player, u32 ack (inputs of the receiver received),
+//   u32 hash tick, u64 state hash at the start of that tick (0 : none),
+//   u32 first tick, u8 count, count * (i8 turn, i8 move, u8 buttons)
+
+#include <vector>
+#include <deque>
+#include <random>
+#include <chrono>
+#include <cstdint>
+
+#include "pool_simulation.h"
+#include "rollback_session.h"
+#include "udp_socket.h"
+
+
+const uint32_t ROLLBACK_MAGIC = 0x4b425250;      // "PRBK"
+const uint16_t ROLLBACK_PORT = 27960;            // Player p receives on ROLLBACK_PORT + p
+const int ROLLBACK_MAX_PACKET_INPUTS = 2 * ROLLBACK_WINDOW;
+const int ROLLBACK_MAX_TICKS_PER_UPDATE = 4;     // A late update only catches up by a few ticks
+
+
+struct RollbackSettings {
+    uint16_t port = ROLLBACK_PORT;
+    double sendDelay = 0.0;   // Seconds added to every packet sent (latency tests)
+    float sendLoss = 0.0f;    // Fraction of the packets sent that are dropped (loss tests)
+};
+
+
+class RollbackPeer
+{
+public:
+    RollbackSession session;
+    uint64_t packetsSent = 0;
+    uint64_t packetsReceived = 0;
+
+    // Starts the match on simulation (see RollbackSession)
+    RollbackPeer(PoolSimulation& simulation, int localPlayer, const RollbackSettings& settings = RollbackSettings());
+
+    // False if the port of the local player is taken
+    bool connected() const {
+        return socket.valid();
+    }
+
+    // Directions held by the local player (turn and move) : every tick takes them until
+    // they change, so a held key turns the cue at the same rate whatever the frame rate.
+    // The buttons of input are pressed (see press)
+    void hold(CueInput input);
+
+    // Buttons of input pressed by the local player, taken by the next tick only
+    void press(CueInput input);
+
+    // Advance by the real time, one tick every ROLLBACK_TICK_TIME. Return the ticks simulated
+    int update(double deltaTime);
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct DelayedPacket {
+        Clock::time_point time;
+        std::vector<uint8_t> data;
+    };
+
+    RollbackSettings settings;
+    UdpSocket socket;
+    CueInput held;            // Directions only
+    uint8_t pressed = 0;      // Buttons since the last tick
+    double accumulator = 0.0;
+    double sinceSent = 0.0;
+    uint32_t remoteAck = 0;   // Local inputs received by the other player
+
+    std::mt19937 lossRng;
+    std::deque<DelayedPacket> delayed;
+    std::vector<uint8_t> packet;
+
+    void receivePackets();
+    void sendInputs();
+    void flushDelayed();
+};
+
+#endif /* ROLLBACK_PEER_H */
@@ -0,0 +1,148 @@
+#include "rollback_session.h"
+
+#include <algorithm>
+
+
+RollbackSession::RollbackSession(PoolSimulation& simulation, int localPlayer) :
+    simulation(simulation),
+    local(localPlayer)
+{
+    simulation.eventDriven = false;
+    simulation.resetGame();
+    simulation.setDeterministic(true);
+    simulation.cue = CueState();
+    simulation.cue.enabled = true;
+}
+
+bool RollbackSession::advance(CueInput input) {
+    rollback();
+
+    if (tick >= remoteCount + ROLLBACK_WINDOW) {
+        stats.stalls++;
+        return false;
+    }
+
+    inputs[local][tick % ROLLBACK_HISTORY] = input;
+    simulateTick(tick);
+    tick++;
+    stats.ticks++;
+    return true;
+}
+
+void RollbackSession::receive(uint32_t t, CueInput input) {
+    if (t != remoteCount) return;
+
+    inputs[remotePlayer()][t % ROLLBACK_HISTORY] = input;
+    remoteCount++;
+
+    // Already simulated : only a wrong prediction of the active player changed the table
+    if (t >= tick) return;
+    const TickState& state = states[t % ROLLBACK_HISTORY];
+    if (state.match.activePlayer != remotePlayer() || input == predicted[t % ROLLBACK_HISTORY]) return;
+    if (rollbackTick < 0 || t < rollbackTick) rollbackTick = t;
+}
+
+bool RollbackSession::confirmedHash(uint32_t& t, uint64_t& hash) const {
+    t = std::min(tick, remoteCount);
+    if (rollbackTick >= 0 && rollbackTick < t) return false;
+
+    if (t == tick) {
+        hash = simulation.stateHash;
+        return true;
+    }
+    if (tick - t >= ROLLBACK_HISTORY) return false;
+
+    hash = states[t % ROLLBACK_HISTORY].table.stateHash;
+    return true;
+}
+
+void RollbackSession::checkRemoteHash(uint32_t t, uint64_t hash) {
+    if (t <= checkedTick) return;
+
+    uint32_t localTick;
+    uint64_t localHash;
+    if (!confirmedHash(localTick, localHash) || localTick < t) return;
+
+    // Start of tick t, confirmed here too
+    if (t < localTick) {
+        if (tick - t >= ROLLBACK_HISTORY) return;
+        localHash = states[t % ROLLBACK_HISTORY].table.stateHash;
+    }
+    if (localHash != hash) stats.desyncs++;
+    checkedTick = t;
+}
+
+// Held from the last input received, without the buttons : a shot is not repeated
+CueInput RollbackSession::remoteInput(uint32_t t) const {
+    if (t < remoteCount) return inputs[remotePlayer()][t % ROLLBACK_HISTORY];
+    if (remoteCount == 0) return CueInput();
+
+    CueInput input = inputs[remotePlayer()][(remoteCount - 1) % ROLLBACK_HISTORY];
+    input.buttons = 0;
+    return input;
+}
+
+void RollbackSession::rollback() {
+    if (rollbackTick < 0) return;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    uint32_t from = (uint32_t)rollbackTick;
+    rollbackTick = -1;
+
+    const TickState& state = states[from % ROLLBACK_HISTORY];
+    simulation.restoreSnapshot(state.table);
+    matchState = state.match;
+    for (uint32_t t = from; t < tick; t++) {
+        simulateTick(t);
+    }
+
+    int depth = (int)(tick - from);
+    stats.rollbacks++;
+    stats.resimulatedTicks += depth;
+    stats.maxRollback = std::max(stats.maxRollback, depth);
+    stats.rollbackNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+void RollbackSession::simulateTick(uint32_t t) {
+    TickState& state = states[t % ROLLBACK_HISTORY];
+    simulation.saveSnapshot(state.table);
+    state.match = matchState;
+
+    CueInput remote = remoteInput(t);
+    predicted[t % ROLLBACK_HISTORY] = remote;
+    applyInput(matchState.activePlayer == local ? inputs[local][t % ROLLBACK_HISTORY] : remote);
+
+    for (int s = 0; s < ROLLBACK_TICK_STEPS; s++) {
+        simulation.stepDeterministic();
+    }
+    updateTurn();
+}
+
+void RollbackSession::applyInput(CueInput input) {
+    if (input.turn) simulation.turnCue(input.turn, ROLLBACK_TICK_TIME);
+    if (input.move) simulation.moveCue(input.move, ROLLBACK_TICK_TIME);
+    if (input.buttons & CUE_SHOOT) simulation.shootCue();
+
+    if (!matchState.shooting && !simulation.cue.takeInput) {
+        matchState.shooting = 1;
+        matchState.pocketedBefore = (uint8_t)pocketedObjectBalls();
+    }
+}
+
+void RollbackSession::updateTurn() {
+    if (!matchState.shooting || !simulation.cue.takeInput || !simulation.balls.allSleeping()) return;
+
+    bool scratch = simulation.balls.inPocket(0);
+    bool pocketed = pocketedObjectBalls() > matchState.pocketedBefore;
+    if (scratch) simulation.resetCueBall();
+    if (scratch || !pocketed) matchState.activePlayer = (uint8_t)(1 - matchState.activePlayer);
+    matchState.shooting = 0;
+}
+
+int RollbackSession::pocketedObjectBalls() const {
+    int count = 0;
+    for (int i = 1; i < simulation.balls.size(); i++) {
+        if (simulation.balls.inPocket(i)) count++;
+    }
+    return count;
+}
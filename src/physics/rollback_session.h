@@ -0,0 +1,149 @@
+#ifndef ROLLBACK_SESSION_H
+#define ROLLBACK_SESSION_H
+
+// Rollback play of two players on one deterministic table : the table advances by
+// ticks of ROLLBACK_TICK_STEPS steps with the cue inputs of both players. The local
+// input is applied at once, the remote one is predicted (the last one received, held)
+// until it arrives. When an input arrives that differs from its prediction, the table
+// is restored from the snapshot of that tick and the ticks since are simulated again.
+// Only the cue inputs are exchanged (see rollback_peer.h), every player simulates the
+// whole table.
+//
+// The players take turns : only the input of the active player moves the cue. A shot
+// ends when the balls are at rest and the cue takes input again; the player keeps the
+// turn when the shot pocketed an object ball and not the cue ball.
+
+#include <cstdint>
+#include <chrono>
+
+#include "pool_simulation.h"
+#include "table_snapshot.h"
+
+
+const int ROLLBACK_TICK_STEPS = 8;            // 60 ticks per second at 480 Hz
+const float ROLLBACK_TICK_TIME = ROLLBACK_TICK_STEPS * FIXED_TIME_STEP;
+const int ROLLBACK_WINDOW = 32;               // Ticks ahead of the remote inputs before waiting for them
+const int ROLLBACK_HISTORY = 4 * ROLLBACK_WINDOW;   // Ticks of inputs and snapshots kept, ring buffers
+const int ROLLBACK_PLAYERS = 2;
+
+
+enum CueButtons : uint8_t {
+    CUE_SHOOT = 1 << 0,
+};
+
+// Cue input of a player during one tick
+struct CueInput {
+    int8_t turn = 0;    // -1, 0 or 1
+    int8_t move = 0;    // -1, 0 or 1
+    uint8_t buttons = 0;
+
+    bool operator==(const CueInput& input) const {
+        return turn == input.turn && move == input.move && buttons == input.buttons;
+    }
+
+    bool operator!=(const CueInput& input) const {
+        return !(*this == input);
+    }
+};
+
+// Turns of the match, rolled back with the table
+struct MatchState {
+    uint8_t activePlayer = 0;
+    uint8_t shooting = 0;         // The active player shot and the balls did not stop yet
+    uint8_t pocketedBefore = 0;   // Object balls in the pockets when the shot started
+};
+
+// Cost of the rollbacks. One tick is one frame of the game
+struct RollbackStats {
+    uint64_t ticks = 0;               // Simulated for the first time
+    uint64_t rollbacks = 0;
+    uint64_t resimulatedTicks = 0;
+    int maxRollback = 0;              // Ticks simulated again by one rollback
+    uint64_t rollbackNanoseconds = 0;
+    uint64_t stalls = 0;              // Ticks not taken, waiting for the remote inputs
+    uint64_t desyncs = 0;             // Confirmed ticks with a state hash different from the remote one
+
+    double rollbackMicrosecondsPerTick() const {
+        return ticks ? rollbackNanoseconds * 1e-3 / ticks : 0.0;
+    }
+};
+
+
+class RollbackSession
+{
+public:
+    RollbackStats stats;
+
+    // Starts the match on simulation, racked and deterministic. The simulation must
+    // only be changed by the session from then on
+    RollbackSession(PoolSimulation& simulation, int localPlayer);
+
+    int localPlayer() const {
+        return local;
+    }
+
+    int remotePlayer() const {
+        return 1 - local;
+    }
+
+    // Next tick to simulate
+    uint32_t currentTick() const {
+        return tick;
+    }
+
+    // Inputs of the remote player received, ticks [0, remoteTicks())
+    uint32_t remoteTicks() const {
+        return remoteCount;
+    }
+
+    const MatchState& match() const {
+        return matchState;
+    }
+
+    // Simulate the next tick with the local input. Return false, and simulate nothing,
+    // when the remote inputs are ROLLBACK_WINDOW ticks behind
+    bool advance(CueInput input);
+
+    // Input of the remote player for tick t. The inputs are taken in order, the others are ignored
+    void receive(uint32_t t, CueInput input);
+
+    CueInput localInput(uint32_t t) const {
+        return inputs[local][t % ROLLBACK_HISTORY];
+    }
+
+    // Last tick whose inputs are all known, and the state hash at its start.
+    // Return false if no such tick is still in the history
+    bool confirmedHash(uint32_t& t, uint64_t& hash) const;
+
+    // Compare with the state hash of the remote table at the start of tick t (see confirmedHash)
+    void checkRemoteHash(uint32_t t, uint64_t hash);
+
+private:
+    struct TickState {
+        TableSnapshot table;
+        MatchState match;
+    };
+
+    PoolSimulation& simulation;
+    int local;
+    MatchState matchState;
+
+    uint32_t tick = 0;
+    uint32_t remoteCount = 0;
+    int64_t rollbackTick = -1;    // Oldest tick simulated with a wrong prediction, -1 if none
+    uint32_t checkedTick = 0;     // Remote hashes compared up to this tick
+
+    // Ring buffers indexed by tick
+    CueInput inputs[ROLLBACK_PLAYERS][ROLLBACK_HISTORY];
+    CueInput predicted[ROLLBACK_HISTORY];   // Remote input the tick was simulated with
+    TickState states[ROLLBACK_HISTORY];     // At the start of the tick
+
+    CueInput remoteInput(uint32_t t) const;
+    void rollback();
+    void simulateTick(uint32_t t);
+    void applyInput(CueInput input);
+    void updateTurn();
+    int pocketedObjectBalls() const;
+};
+
+#endif /* ROLLBACK_SESSION_H */
@@ -0,0 +1,161 @@
+#ifndef SHOT_CACHE_H
+#define SHOT_CACHE_H
+
+// LRU cache of shot outcomes. The key is the table state (positions, velocities and
+// spins) and the cue parameters quantized, so that shots that differ only by aiming
+// jitter share one entry : the outcome returned is the one simulated for the first
+// shot of its cell.
+// Safe to use from several threads.
+
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "ball_state.h"
+#include "state_hash.h"
+#include "quantize.h"
+#include "shot_outcome.h"
+
+
+struct ShotKey {
+    std::vector<int32_t> values;   // Quantized cue parameters, then ball positions, velocities, spins and pocket flags
+    uint64_t hash = 0;
+
+    bool operator==(const ShotKey& key) const {
+        return hash == key.hash && values == key.values;
+    }
+};
+
+struct ShotKeyHash {
+    size_t operator()(const ShotKey& key) const {
+        return (size_t)key.hash;
+    }
+};
+
+
+class ShotCache
+{
+public:
+    // Quantization steps
+    float positionStep;
+    float angleStep;    // Degrees
+    float forceStep;
+    float velocityStep; // Table units per second, radians per second for the spins
+
+    std::atomic<long> hits{0};
+    std::atomic<long> misses{0};
+    std::atomic<long> evictions{0};
+
+    ShotCache(size_t capacity = 4096, float positionStep = 0.01f, float angleStep = 0.05f, float forceStep = 0.5f,
+              float velocityStep = 0.01f) :
+        positionStep(positionStep), angleStep(angleStep), forceStep(forceStep), velocityStep(velocityStep), capacity(capacity)
+    {}
+
+    ShotKey makeKey(const BallState& state, float azimuthal, float force) const {
+        ShotKey key;
+        key.values.reserve(2 + 8 * state.size());
+
+        // Same direction modulo 360 degrees
+        float angle = azimuthal - 360.0f * glm::floor(azimuthal / 360.0f);
+        key.values.push_back(quantize(angle, angleStep));
+        key.values.push_back(quantize(force, forceStep));
+
+        for (int i = 0; i < state.size(); i++) {
+            bool inPocket = state.inPocket(i);
+            key.values.push_back(inPocket ? 0 : quantize(state.x[i], positionStep));
+            key.values.push_back(inPocket ? 0 : quantize(state.y[i], positionStep));
+            key.values.push_back(inPocket ? 0 : quantize(state.vx[i], velocityStep));
+            key.values.push_back(inPocket ? 0 : quantize(state.vy[i], velocityStep));
+            key.values.push_back(inPocket ? 0 : quantize(state.wx[i], velocityStep));
+            key.values.push_back(inPocket ? 0 : quantize(state.wy[i], velocityStep));
+            key.values.push_back(inPocket ? 0 : quantize(state.wz[i], velocityStep));
+            key.values.push_back(inPocket ? 1 : 0);
+        }
+
+        key.hash = hashBytes(key.values.data(), key.values.size() * sizeof(int32_t));
+        return key;
+    }
+
+    // Copy the outcome of key in outcome if cached
+    bool find(const ShotKey& key, ShotOutcome& outcome) {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        auto it = index.find(key);
+        if (it == index.end()) {
+            misses++;
+            return false;
+        }
+
+        // Most recently used first
+        entries.splice(entries.begin(), entries, it->second);
+        outcome = it->second->second;
+        hits++;
+        return true;
+    }
+
+    void insert(const ShotKey& key, const ShotOutcome& outcome) {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        auto it = index.find(key);
+        if (it != index.end()) {
+            it->second->second = outcome;
+            entries.splice(entries.begin(), entries, it->second);
+            return;
+        }
+
+        entries.emplace_front(key, outcome);
+        index[key] = entries.begin();
+
+        if (entries.size() > capacity) {
+            index.erase(entries.back().first);
+            entries.pop_back();
+            evictions++;
+        }
+    }
+
+    // Cached outcome of the shot, simulated with simulateShot on a miss
+    ShotOutcome simulate(PoolSimulation& simulation, const BallState& start, float azimuthal, float force, float maxTime) {
+        ShotKey key = makeKey(start, azimuthal, force);
+
+        ShotOutcome outcome;
+        if (find(key, outcome)) return outcome;
+
+        outcome = simulateShot(simulation, start, azimuthal, force, maxTime);
+        insert(key, outcome);
+        return outcome;
+    }
+
+    size_t size() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return entries.size();
+    }
+
+    double hitRate() const {
+        long lookups = hits + misses;
+        return lookups > 0 ? (double)hits / lookups : 0.0;
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex);
+        entries.clear();
+        index.clear();
+        hits = 0;
+        misses = 0;
+        evictions = 0;
+    }
+
+private:
+    typedef std::pair<ShotKey, ShotOutcome> Entry;
+
+    size_t capacity;
+    std::mutex mutex;
+    std::list<Entry> entries;   // Most recently used first
+    std::unordered_map<ShotKey, std::list<Entry>::iterator, ShotKeyHash> index;
+};
+
+#endif /* SHOT_CACHE_H */
@@ -0,0 +1,79 @@
+#ifndef SHOT_OUTCOME_H
+#define SHOT_OUTCOME_H
+
+// Result of playing one shot to the rest of all the balls : final state and
+// the events of the shot (first ball hit by the cue ball, pocketed balls).
+
+#include <vector>
+
+#include "pool_simulation.h"
+
+
+struct ShotEvent {
+    int step;     // Physics step of the event
+    int ball;
+    int pocket;   // Pocket the ball entered
+};
+
+struct ShotOutcome {
+    BallState finalState;
+    std::vector<ShotEvent> pocketed;   // In the order the balls were pocketed
+    int firstHit = -1;                 // First object ball hit by the cue ball, -1 if none
+    int steps = 0;
+
+    int objectBallsPocketed() const {
+        int count = 0;
+        for (const ShotEvent& event : pocketed) {
+            if (event.ball != 0) count++;
+        }
+        return count;
+    }
+
+    bool scratch() const {
+        for (const ShotEvent& event : pocketed) {
+            if (event.ball == 0) return true;
+        }
+        return false;
+    }
+};
+
+// Play a shot on the cue ball (ball 0) of start with fixed steps of simulation,
+// until all the balls are at rest or maxTime simulated seconds have passed.
+// simulation gives the pockets, the table size and the scratch buffers, its balls are overwritten
+inline ShotOutcome simulateShot(PoolSimulation& simulation, const BallState& start, float azimuthal, float force, float maxTime) {
+    ShotOutcome outcome;
+    BallState& balls = simulation.balls;
+    balls = start;
+
+    std::vector<bool> inPocket(balls.size());
+    for (int i = 0; i < balls.size(); i++) {
+        inPocket[i] = start.inPocket(i);
+    }
+
+    impulseBall(balls, 0, force, azimuthal);
+
+    int maxSteps = (int)(maxTime / simulation.timeStep);
+    while (outcome.steps < maxSteps && !balls.allSleeping()) {
+        simulation.step(simulation.timeStep);
+        outcome.steps++;
+
+        for (int i = 0; i < balls.size(); i++) {
+            if (balls.inPocket(i) && !inPocket[i]) {
+                inPocket[i] = true;
+                outcome.pocketed.push_back({outcome.steps, i, balls.pocket[i]});
+            }
+
+            // The first object ball at rest to start moving was hit by the cue ball
+            bool wasAtRest = start.vx[i] == 0.0f && start.vy[i] == 0.0f;
+            bool moving = balls.vx[i] != 0.0f || balls.vy[i] != 0.0f;
+            if (outcome.firstHit < 0 && i != 0 && wasAtRest && moving) {
+                outcome.firstHit = i;
+            }
+        }
+    }
+
+    outcome.finalState = balls;
+    return outcome;
+}
+
+#endif /* SHOT_OUTCOME_H */
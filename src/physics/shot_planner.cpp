@@ -0,0 +1,135 @@
+#include "shot_planner.h"
+
+#include <random>
+#include <chrono>
+#include <algorithm>
+
+
+ShotPlanner::ShotPlanner(ShotPlannerSettings settings, int threadCount) :
+    settings(settings),
+    pool(threadCount)
+{
+    for (int w = 0; w < pool.size(); w++) {
+        workerTables.emplace_back(new PoolSimulation());
+    }
+}
+
+std::vector<PlannedShot> ShotPlanner::plan(const PoolSimulation& table) {
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(settings.timeBudget));
+
+    played = 0;
+    if (table.balls.size() == 0 || table.balls.inPocket(0)) return std::vector<PlannedShot>();
+
+    // Candidates : uniform over the directions and forces
+    std::mt19937 rng(settings.seed);
+    std::uniform_real_distribution<float> randAngle(0.0f, 360.0f);
+    std::uniform_real_distribution<float> randForce(settings.minForce, settings.maxForce);
+
+    int candidateCount = settings.candidates;
+    int sampleCount = settings.samplesPerCandidate;
+    std::vector<PlannedShot> shots(candidateCount);
+    for (PlannedShot& shot : shots) {
+        shot.azimuthal = randAngle(rng);
+        shot.force = randForce(rng);
+    }
+
+    for (std::unique_ptr<PoolSimulation>& workerTable : workerTables) {
+        workerTable->maxX = table.maxX;
+        workerTable->maxY = table.maxY;
+        workerTable->pockets = table.pockets;
+        workerTable->scratch = StepScratch(table.maxX, table.maxY);
+        workerTable->phaseMotion = table.phaseMotion;
+        workerTable->eventDriven = false;
+        workerTable->deterministic = false;
+    }
+    outcomes.assign((size_t)candidateCount * sampleCount, Outcome{-1, false});
+
+    // Successive halving : every round plays one more sample of the active candidates,
+    // then only the best half stays active. Most of the time goes to the promising shots
+    std::vector<int> active(candidateCount);
+    for (int c = 0; c < candidateCount; c++) {
+        active[c] = c;
+    }
+
+    for (int s = 0; s < sampleCount && !active.empty() && Clock::now() < deadline; s++) {
+        pool.parallelFor((int)active.size(), 16, [&](int begin, int end, int worker) {
+            PoolSimulation& simulation = *workerTables[worker];
+
+            for (int k = begin; k < end; k++) {
+                if (Clock::now() >= deadline) return;
+
+                // Noise seeded by candidate and sample, independent of the worker
+                int c = active[k];
+                std::mt19937 noiseRng(settings.seed ^ (uint32_t)(c * 7919 + s * 104729 + 1));
+                std::normal_distribution<float> angleNoise(0.0f, settings.angleNoise);
+                std::normal_distribution<float> forceNoise(0.0f, settings.forceNoise);
+
+                const PlannedShot& shot = shots[c];
+                float azimuthal = shot.azimuthal + angleNoise(noiseRng);
+                float force = glm::max(0.0f, shot.force * (1.0f + forceNoise(noiseRng)));
+
+                outcomes[(size_t)c * sampleCount + s] = playShot(simulation, table, azimuthal, force);
+            }
+        });
+
+        for (int c : active) {
+            computeStatistics(shots[c], &outcomes[(size_t)c * sampleCount], sampleCount);
+        }
+        std::sort(active.begin(), active.end(), [&](int a, int b) {
+            return better(shots[a], shots[b]);
+        });
+        active.resize(std::max(glm::min((int)active.size(), MIN_ACTIVE_CANDIDATES), (int)active.size() / 2));
+    }
+
+    // Ranking of the candidates played at least once. The estimate of a candidate dropped
+    // after a few lucky samples is not comparable to the one of a survivor : the candidates
+    // with the most samples come first, each group by its own statistics
+    std::vector<PlannedShot> ranked;
+    for (int c = 0; c < candidateCount; c++) {
+        computeStatistics(shots[c], &outcomes[(size_t)c * sampleCount], sampleCount);
+        if (shots[c].samples == 0) continue;
+
+        played += shots[c].samples;
+        ranked.push_back(shots[c]);
+    }
+    std::sort(ranked.begin(), ranked.end(), [](const PlannedShot& a, const PlannedShot& b) {
+        if (a.samples != b.samples) return a.samples > b.samples;
+        return better(a, b);
+    });
+
+    return ranked;
+}
+
+bool ShotPlanner::better(const PlannedShot& a, const PlannedShot& b) {
+    if (a.pocketProbability != b.pocketProbability) return a.pocketProbability > b.pocketProbability;
+    if (a.expectedPocketed != b.expectedPocketed) return a.expectedPocketed > b.expectedPocketed;
+    return a.samples > b.samples;
+}
+
+void ShotPlanner::computeStatistics(PlannedShot& shot, const Outcome* outcomes, int sampleCount) {
+    int samples = 0, success = 0, pocketed = 0, scratches = 0;
+
+    for (int s = 0; s < sampleCount; s++) {
+        const Outcome& outcome = outcomes[s];
+        if (outcome.pocketed < 0) continue;
+
+        samples++;
+        pocketed += outcome.pocketed;
+        if (outcome.scratch) scratches++;
+        else if (outcome.pocketed > 0) success++;
+    }
+
+    shot.samples = samples;
+    shot.pocketProbability = samples > 0 ? (float)success / samples : 0.0f;
+    shot.expectedPocketed = samples > 0 ? (float)pocketed / samples : 0.0f;
+    shot.scratchProbability = samples > 0 ? (float)scratches / samples : 0.0f;
+}
+
+ShotPlanner::Outcome ShotPlanner::playShot(PoolSimulation& simulation, const PoolSimulation& table, float azimuthal, float force) {
+    ShotOutcome shot = cache ? cache->simulate(simulation, table.balls, azimuthal, force, settings.maxShotTime)
+                             : simulateShot(simulation, table.balls, azimuthal, force, settings.maxShotTime);
+
+    return Outcome{(int8_t)shot.objectBallsPocketed(), shot.scratch()};
+}
@@ -0,0 +1,85 @@
+#ifndef SHOT_PLANNER_H
+#define SHOT_PLANNER_H
+
+// Monte-Carlo shot planner : samples candidate shots (cue direction and force),
+// plays them with some noise on the execution, each time from the current table
+// to the rest of all the balls, and ranks the candidates by their probability to
+// pocket a ball. Every candidate is played once, and the best half of them once
+// more at each round (successive halving).
+// The samples run on a ThreadPool, every worker with its own copy of the table.
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+#include "pool_simulation.h"
+#include "thread_pool.h"
+#include "shot_outcome.h"
+#include "shot_cache.h"
+
+
+// Candidates kept by the successive halving until they have all their samples
+const int MIN_ACTIVE_CANDIDATES = 32;
+
+
+struct ShotPlannerSettings {
+    int candidates = 2048;
+    int samplesPerCandidate = 16;   // Noisy executions of the best candidates
+    double timeBudget = 0.5;        // Seconds, the planning stops with fewer samples when exceeded
+
+    float minForce = FORCE_MIN;
+    float maxForce = FORCE_MAX;
+    float angleNoise = 0.5f;        // Standard deviation of the execution, in degrees
+    float forceNoise = 0.05f;       // Standard deviation of the execution, relative to the force
+
+    float maxShotTime = 30.0f;      // Simulated seconds before a shot is stopped
+    uint32_t seed = 1;
+};
+
+struct PlannedShot {
+    float azimuthal;
+    float force;
+    int samples;                    // Executions played within the time budget
+    float pocketProbability;        // At least one object ball pocketed, and not the cue ball
+    float expectedPocketed;         // Object balls pocketed on average
+    float scratchProbability;       // Cue ball pocketed
+};
+
+
+class ShotPlanner
+{
+public:
+    ShotPlannerSettings settings;
+    ShotCache* cache = nullptr;   // Optional, shared by the workers
+
+    // threadCount <= 0 : one thread per hardware thread
+    ShotPlanner(ShotPlannerSettings settings = ShotPlannerSettings(), int threadCount = 0);
+
+    // Candidates from the state of table (ball 0 is the cue ball), best first : the
+    // candidates played the most times first, then by pocket probability.
+    // Candidates that could not be played within the time budget are left out
+    std::vector<PlannedShot> plan(const PoolSimulation& table);
+
+    // Samples played by the last plan
+    long samplesPlayed() const {
+        return played;
+    }
+
+private:
+    struct Outcome {
+        int8_t pocketed;   // Object balls, -1 if not played
+        bool scratch;
+    };
+
+    ThreadPool pool;
+    std::vector<std::unique_ptr<PoolSimulation>> workerTables;
+    std::vector<Outcome> outcomes;
+    long played = 0;
+
+    Outcome playShot(PoolSimulation& simulation, const PoolSimulation& table, float azimuthal, float force);
+
+    static bool better(const PlannedShot& a, const PlannedShot& b);
+    static void computeStatistics(PlannedShot& shot, const Outcome* outcomes, int sampleCount);
+};
+
+#endif /* SHOT_PLANNER_H */
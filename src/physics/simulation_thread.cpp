@@ -0,0 +1,115 @@
+#include "simulation_thread.h"
+
+
+SimulationThread::SimulationThread(int ballCount, double period) :
+    period(period)
+{
+    simulation.stats = &physicsStats;
+    if (ballCount != BALL_COUNT) {
+        simulation.setupSandbox(ballCount);
+        // A step of a large sandbox can take longer than a tick : a late tick only
+        // runs a few steps, so that the commands are still applied at a steady rate
+        simulation.maxSubsteps = SANDBOX_MAX_SUBSTEPS;
+
+        if (std::thread::hardware_concurrency() > 1) {
+            contactPool.reset(new ThreadPool());
+            simulation.contactPool = contactPool.get();
+        }
+    }
+
+    // The game thread has a frame to read before the first tick
+    publish(1.0f, simulation.timeStep, std::chrono::steady_clock::now());
+    frames.update();
+
+    thread = std::thread(&SimulationThread::run, this);
+}
+
+SimulationThread::~SimulationThread() {
+    running = false;
+    thread.join();
+}
+
+uint64_t SimulationThread::post(Command command) {
+    if (!commands.push(std::move(command))) return 0;
+    return ++posted;
+}
+
+void SimulationThread::applyInput(TableInput input) {
+    input.step = simulation.stepCount;
+    simulation.applyInput(input);
+
+    if (inputLog.push(input)) inputsLogged++;
+    else inputsLost++;
+}
+
+void SimulationThread::run() {
+    typedef std::chrono::steady_clock Clock;
+
+    Clock::duration tick = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(period));
+    Clock::time_point last = Clock::now();
+    Clock::time_point next = last;
+    Command command;
+
+    while (running) {
+        while (commands.pop(command)) {
+            command(simulation);
+            applied++;
+        }
+        command = nullptr;
+
+        // The simulation consumes the real time since the last tick, so a late tick
+        // only makes the next update longer
+        Clock::time_point now = Clock::now();
+        double deltaTime = std::chrono::duration<double>(now - last).count();
+        last = now;
+
+        float alpha = 1.0f;
+        if (!paused) alpha = driver ? driver(simulation, deltaTime) : simulation.update(deltaTime);
+
+        bool stepped = simulation.fixedStep && !simulation.eventDriven;
+        publish(alpha, stepped ? simulation.timeStep : (float)deltaTime, now);
+        ticks++;
+
+        next += tick;
+        if (next < now) {
+            // Behind : start again from now instead of running the missed ticks back to back
+            lateTicks++;
+            next = now + tick;
+        }
+        std::this_thread::sleep_until(next);
+    }
+}
+
+void SimulationThread::publish(float alpha, float interval, std::chrono::steady_clock::time_point now) {
+    const BallState& balls = simulation.balls;
+    TableFrame& frame = frames.back();
+
+    frame.positions.resize(balls.size());
+    frame.lastPositions.resize(balls.size());
+    frame.orientations.resize(balls.size());
+    frame.radius.resize(balls.size());
+    frame.flags.resize(balls.size());
+    for (int i = 0; i < balls.size(); i++) {
+        frame.positions[i] = balls.position(i);
+        frame.lastPositions[i] = balls.lastPosition(i);
+        frame.orientations[i] = balls.orientation(i);
+        frame.radius[i] = balls.radius[i];
+        frame.flags[i] = balls.flags[i];
+    }
+
+    frame.cue = simulation.cue;
+    frame.eventDriven = simulation.eventDriven;
+    frame.pockets = simulation.pockets;
+    frame.maxX = simulation.maxX;
+    frame.maxY = simulation.maxY;
+    frame.alpha = alpha;
+    frame.interval = interval;
+    frame.time = now;
+    frame.commands = applied;
+    frame.stepCount = simulation.stepCount;
+    frame.stateHash = simulation.stateHash;
+    frame.inputs = inputsLogged;
+    frame.inputsLost = inputsLost;
+
+    frames.publish();
+}
@@ -0,0 +1,197 @@
+#ifndef SIMULATION_THREAD_H
+#define SIMULATION_THREAD_H
+
+// Runs a PoolSimulation on its own thread at a fixed rate. The game thread sends
+// commands through a lock-free queue and reads the state of the table from a
+// lock-free triple buffer, so rendering never waits for the physics and the physics
+// never waits for rendering.
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "pool_simulation.h"
+#include "triple_buffer.h"
+#include "spsc_queue.h"
+#include "thread_pool.h"
+
+
+const int SANDBOX_MAX_SUBSTEPS = 4;
+
+
+// State of the table published by the simulation thread after every tick
+struct TableFrame {
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> lastPositions;   // Before the last physics step
+    std::vector<glm::quat> orientations;
+    std::vector<float> radius;
+    std::vector<uint8_t> flags;
+    CueState cue;
+    bool eventDriven = false;
+
+    // Table, does not change between frames
+    std::vector<PoolPocket> pockets;
+    float maxX = 0.0f;
+    float maxY = 0.0f;
+
+    float alpha = 1.0f;       // Interpolation factor between the two last physics steps when published
+    float interval = 0.0f;    // Time between the two last physics steps
+    std::chrono::steady_clock::time_point time;   // When the frame was published
+    uint64_t commands = 0;    // Number of commands applied to the simulation
+    uint64_t stepCount = 0;
+    uint64_t stateHash = 0;   // Of the deterministic simulation (see PoolSimulation::deterministic)
+    uint64_t inputs = 0;      // Number of inputs logged (see SimulationThread::nextInput)
+    uint64_t inputsLost = 0;  // Inputs applied but not logged, the log was full
+
+    int size() const {
+        return (int)positions.size();
+    }
+
+    glm::vec3 position(int i) const {
+        return positions[i];
+    }
+
+    glm::vec3 lastPosition(int i) const {
+        return lastPositions[i];
+    }
+
+    glm::quat orientation(int i) const {
+        return orientations[i];
+    }
+
+    bool inPocket(int i) const {
+        return flags[i] & BALL_IN_POCKET;
+    }
+
+    bool sleeping(int i) const {
+        return flags[i] & BALL_SLEEPING;
+    }
+
+    bool allSleeping() const {
+        for (uint8_t f : flags) {
+            if (!(f & BALL_SLEEPING)) return false;
+        }
+        return true;
+    }
+
+    // Interpolation factor at time now : the frame is extrapolated by the time since it was published
+    float alphaAt(std::chrono::steady_clock::time_point now) const {
+        if (interval <= 0.0f || alpha >= 1.0f) return 1.0f;
+        float elapsed = std::chrono::duration<float>(now - time).count();
+        return glm::clamp(alpha + elapsed / interval, 0.0f, 1.0f);
+    }
+};
+
+
+class SimulationThread
+{
+public:
+    // Runs on the simulation thread, between two ticks
+    typedef std::function<void(PoolSimulation&)> Command;
+
+    // Runs on the simulation thread instead of the update of the simulation, with the time
+    // since the last tick (for example the ticks of a rollback match, see rollback_peer.h).
+    // Return the interpolation factor, as PoolSimulation::update
+    typedef std::function<float(PoolSimulation&, double)> Driver;
+
+    static const size_t COMMAND_CAPACITY = 256;
+    static const size_t INPUT_LOG_CAPACITY = 1024;
+
+    // Ticks, and ticks that started late (the thread could not keep the rate)
+    std::atomic<long> ticks{0};
+    std::atomic<long> lateTicks{0};
+
+    // ballCount : other than BALL_COUNT, the simulation is a sandbox of that many balls (see setupSandbox).
+    // period : time between two ticks, the time step of the simulation by default
+    explicit SimulationThread(int ballCount = BALL_COUNT, double period = FIXED_TIME_STEP);
+    ~SimulationThread();
+
+    SimulationThread(const SimulationThread&) = delete;
+    SimulationThread& operator=(const SimulationThread&) = delete;
+
+    // Game thread : queue a command for the next tick.
+    // Return its number (see TableFrame::commands), 0 if the queue is full
+    uint64_t post(Command command);
+
+    // Game thread : queue an input for the next tick (see table_input.h).
+    // Return the number of its command, 0 if the queue is full
+    uint64_t postInput(TableInput input) {
+        return post([this, input](PoolSimulation&) {
+            applyInput(input);
+        });
+    }
+
+    // Simulation thread, from a command : apply an input to the simulation and log it
+    // with the step it was applied at
+    void applyInput(TableInput input);
+
+    // Simulation thread : inputs logged so far, as TableFrame::inputs
+    uint64_t inputCount() const {
+        return inputsLogged;
+    }
+
+    // Game thread : next input of the log, in the order they were applied. The inputs
+    // applied before a frame was published are in the log when the frame is read
+    // (see TableFrame::inputs). Return false if the log is empty
+    bool nextInput(TableInput& input) {
+        return inputLog.pop(input);
+    }
+
+    // Game thread : latest state of the table, never blocks.
+    // Valid until the next call
+    const TableFrame& latest() {
+        frames.update();
+        return frames.front();
+    }
+
+    // Any thread : counters of the physics steps (see physics_stats.h)
+    const PhysicsStats& stats() const {
+        return physicsStats;
+    }
+
+    // Game thread : drive the simulation from the next tick on (null : its own update).
+    // Return the number of the command, 0 if the queue is full
+    uint64_t setDriver(Driver driver) {
+        return post([this, driver](PoolSimulation&) {
+            this->driver = driver;
+        });
+    }
+
+    // The commands are still applied while paused
+    void setPaused(bool pause) {
+        paused = pause;
+    }
+
+private:
+    PhysicsStats physicsStats;
+    std::unique_ptr<ThreadPool> contactPool;   // Sandbox on several cores
+    PoolSimulation simulation;
+    double period;
+
+    Driver driver;   // Simulation thread
+
+    SpscQueue<Command, COMMAND_CAPACITY> commands;
+    uint64_t posted = 0;    // Game thread
+    uint64_t applied = 0;   // Simulation thread
+
+    SpscQueue<TableInput, INPUT_LOG_CAPACITY> inputLog;
+    uint64_t inputsLogged = 0;   // Simulation thread
+    uint64_t inputsLost = 0;
+
+    TripleBuffer<TableFrame> frames;
+
+    std::atomic<bool> running{true};
+    std::atomic<bool> paused{false};
+    std::thread thread;
+
+    void run();
+    void publish(float alpha, float interval, std::chrono::steady_clock::time_point now);
+};
+
+#endif /* SIMULATION_THREAD_H */
@@ -0,0 +1,49 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+// Lock-free bounded queue between one producer thread and one consumer thread.
+// Capacity must be a power of two.
+
+#include <atomic>
+#include <array>
+#include <cstddef>
+#include <utility>
+
+
+template<typename T, size_t Capacity>
+class SpscQueue
+{
+    static_assert((Capacity & (Capacity - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+public:
+    // Producer : return false if the queue is full
+    bool push(T value) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) == Capacity) return false;
+
+        slots[h & (Capacity - 1)] = std::move(value);
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer : return false if the queue is empty
+    bool pop(T& value) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) return false;
+
+        value = std::move(slots[t & (Capacity - 1)]);
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::array<T, Capacity> slots;
+    // On separate cache lines, so that the producer and the consumer do not share one
+    // (C++14 new does not guarantee alignas(64), hence the padding)
+    char padding0[64];
+    std::atomic<size_t> head{0};   // Next slot written
+    char padding1[64];
+    std::atomic<size_t> tail{0};   // Next slot read
+};
+
+#endif /* SPSC_QUEUE_H */
@@ -0,0 +1,44 @@
+#ifndef STATE_HASH_H
+#define STATE_HASH_H
+
+// Hash of the physics state of a table, used to compare two runs step by step
+// (replays, regression checks). Floats are hashed by their bit pattern : two states
+// only have the same hash if they are bitwise identical.
+
+#include <cstdint>
+#include <vector>
+
+#include "ball_state.h"
+
+
+const uint64_t FNV_OFFSET = 14695981039346656037ull;
+const uint64_t FNV_PRIME = 1099511628211ull;
+
+// 64-bit FNV-1a
+inline uint64_t hashBytes(const void* data, size_t size, uint64_t hash = FNV_OFFSET) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+template<typename T>
+inline uint64_t hashArray(const std::vector<T>& array, uint64_t hash) {
+    return hashBytes(array.data(), array.size() * sizeof(T), hash);
+}
+
+template<typename Real>
+inline uint64_t hashBallState(const BasicBallState<Real>& s) {
+    uint64_t hash = FNV_OFFSET;
+    for (const std::vector<Real>* array : {&s.x, &s.y, &s.z, &s.vx, &s.vy, &s.vz, &s.ax, &s.ay, &s.az,
+                                             &s.wx, &s.wy, &s.wz, &s.qw, &s.qx, &s.qy, &s.qz}) {
+        hash = hashArray(*array, hash);
+    }
+    hash = hashArray(s.flags, hash);
+    hash = hashArray(s.pocket, hash);
+    return hash;
+}
+
+#endif /* STATE_HASH_H */
@@ -0,0 +1,174 @@
+#ifndef TABLE_GEOMETRY_H
+#define TABLE_GEOMETRY_H
+
+// Collision geometry of the table, computed once : the rails are the bounds of the
+// playing area, and every pocket (mouth between the jaws, throat) is converted to the
+// precision of the physics with its derived values. A coarse grid over the table
+// lists the pockets that can reach each cell, so that a ball at a rail only tests
+// the pocket in front of it instead of all of them.
+
+#include <vector>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+#include <glm/gtx/rotate_vector.hpp>
+
+#include "precision.h"
+
+
+const float POCKET_RADIUS = 4.8f;
+const float POCKET_DEPTH = 8.0f;
+const float POCKET_MINDIST = 30.0f;
+const float POCKET_X = 56.0f;
+const float POCKET_X2 = 52.0f;
+const float POCKET_Y = 102.0f;
+const float POCKET_REST_SPEED = 5.0f;  // Below this vertical speed, a ball stops bouncing at the bottom of a pocket
+
+
+struct PoolPocket {
+    glm::vec3 Position;
+    float Radius;
+    float depth;
+    glm::vec3 Direction;
+    float minDist;
+
+    PoolPocket() {}
+
+    PoolPocket(float x, float y, float angle, float Radius = POCKET_RADIUS, float depth = POCKET_DEPTH, float minDist = POCKET_MINDIST) 
+    : minDist(minDist), Radius(Radius), depth(depth) 
+    {
+        Position = glm::vec3(x, y, 0.0f);
+        setDirection(angle);
+    }
+
+    void setDirection(float angle) {
+        Direction = glm::rotate(glm::vec3(1.0f, 0.0f, 0.0f), glm::radians(angle), glm::vec3(0.0f, 0.0f, 1.0f));
+    }
+};
+
+
+const float TABLE_CELL_SIZE = 10.0f;   // Table units
+
+
+// A pocket in the precision of the physics, see checkPocket
+template<typename Real>
+struct PocketFeature {
+    Real x, y;              // Center of the throat
+    Real dirX, dirY;        // Axis of the mouth, pointing to the table
+    Real dirLength2;
+    Real radius;            // Half width of the mouth and radius of the throat
+    Real radius2;
+    Real depth;
+    Real minDist2;          // Square of the distance under which the pocket is tested
+    int index;              // In the pockets of the simulation
+};
+
+template<typename Real>
+class BasicTableGeometry
+{
+public:
+    std::vector<PocketFeature<Real>> pockets;
+    Real maxX = Real(0);
+    Real maxY = Real(0);
+
+    void build(const std::vector<PoolPocket>& tablePockets, float tableMaxX, float tableMaxY) {
+        source = tablePockets;
+        sourceMaxX = tableMaxX;
+        sourceMaxY = tableMaxY;
+        maxX = Real(tableMaxX);
+        maxY = Real(tableMaxY);
+
+        pockets.clear();
+        for (int p = 0; p < (int)tablePockets.size(); p++) {
+            const PoolPocket& pocket = tablePockets[p];
+            PocketFeature<Real> feature;
+            feature.x = Real(pocket.Position.x);
+            feature.y = Real(pocket.Position.y);
+            feature.dirX = Real(pocket.Direction.x);
+            feature.dirY = Real(pocket.Direction.y);
+            feature.dirLength2 = feature.dirX * feature.dirX + feature.dirY * feature.dirY;
+            feature.radius = Real(pocket.Radius);
+            feature.radius2 = Real(pocket.Radius * pocket.Radius);
+            feature.depth = Real(pocket.depth);
+            feature.minDist2 = Real(pocket.minDist * pocket.minDist);
+            feature.index = p;
+            pockets.push_back(feature);
+        }
+
+        buildGrid();
+    }
+
+    // True if the geometry was built from these pockets and bounds
+    bool builtFor(const std::vector<PoolPocket>& tablePockets, float tableMaxX, float tableMaxY) const {
+        if (tableMaxX != sourceMaxX || tableMaxY != sourceMaxY || tablePockets.size() != source.size()) return false;
+
+        for (size_t p = 0; p < source.size(); p++) {
+            const PoolPocket& a = tablePockets[p];
+            const PoolPocket& b = source[p];
+            if (a.Position != b.Position || a.Direction != b.Direction || a.Radius != b.Radius ||
+                a.depth != b.depth || a.minDist != b.minDist) return false;
+        }
+        return true;
+    }
+
+    // Pockets that can reach the cell of (x, y), in pocket order
+    const uint8_t* pocketsNear(Real x, Real y, int& count) const {
+        int cx = glm::clamp((int)((toFloat(x) - originX) / TABLE_CELL_SIZE), 0, cellsX - 1);
+        int cy = glm::clamp((int)((toFloat(y) - originY) / TABLE_CELL_SIZE), 0, cellsY - 1);
+        int cell = cy * cellsX + cx;
+
+        count = cellStart[cell + 1] - cellStart[cell];
+        return cellPockets.data() + cellStart[cell];
+    }
+
+private:
+    std::vector<PoolPocket> source;
+    float sourceMaxX = 0.0f;
+    float sourceMaxY = 0.0f;
+
+    // Cells of the grid, with the pockets of cell c at cellPockets[cellStart[c] .. cellStart[c + 1])
+    float originX = 0.0f;
+    float originY = 0.0f;
+    int cellsX = 0;
+    int cellsY = 0;
+    std::vector<int> cellStart;
+    std::vector<uint8_t> cellPockets;
+
+    void buildGrid() {
+        // The playing area and the zones of the pockets
+        glm::vec2 low = glm::vec2(-sourceMaxX, -sourceMaxY);
+        glm::vec2 high = glm::vec2(sourceMaxX, sourceMaxY);
+        for (const PoolPocket& pocket : source) {
+            low = glm::min(low, glm::vec2(pocket.Position) - pocket.minDist);
+            high = glm::max(high, glm::vec2(pocket.Position) + pocket.minDist);
+        }
+
+        originX = low.x;
+        originY = low.y;
+        cellsX = glm::max(1, (int)glm::ceil((high.x - low.x) / TABLE_CELL_SIZE));
+        cellsY = glm::max(1, (int)glm::ceil((high.y - low.y) / TABLE_CELL_SIZE));
+
+        cellStart.assign(1, 0);
+        cellPockets.clear();
+        for (int cy = 0; cy < cellsY; cy++) {
+            for (int cx = 0; cx < cellsX; cx++) {
+                // With a margin for the rounding of the cell lookup
+                glm::vec2 cellLow = glm::vec2(originX + cx * TABLE_CELL_SIZE, originY + cy * TABLE_CELL_SIZE) - 0.01f;
+                glm::vec2 cellHigh = cellLow + TABLE_CELL_SIZE + 0.02f;
+
+                // The pockets whose test zone overlaps the cell
+                for (int p = 0; p < (int)source.size(); p++) {
+                    glm::vec2 center = glm::vec2(source[p].Position);
+                    glm::vec2 closest = glm::clamp(center, cellLow, cellHigh);
+                    glm::vec2 d = closest - center;
+                    if (glm::dot(d, d) <= source[p].minDist * source[p].minDist) {
+                        cellPockets.push_back((uint8_t)p);
+                    }
+                }
+                cellStart.push_back((int)cellPockets.size());
+            }
+        }
+    }
+};
+
+#endif /* TABLE_GEOMETRY_H */
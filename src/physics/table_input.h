@@ -0,0 +1,36 @@
+#ifndef TABLE_INPUT_H
+#define TABLE_INPUT_H
+
+// Commands of the player that change a table, as values instead of code : the game
+// applies them on the simulation thread (see SimulationThread::postInput), which logs
+// each with the step it was applied at, so that a replay can apply them again at the
+// same steps and check the state hashes of the recording (see ReplayChecker).
+
+#include <cstdint>
+
+
+enum TableInputType : uint8_t {
+    TABLE_TURN_CUE = 0,          // value : direction, time : seconds
+    TABLE_MOVE_CUE,              // value : direction, time : seconds
+    TABLE_SHOOT_CUE,
+    TABLE_SWITCH_CUE,
+    TABLE_AIM_CUE,               // value : azimuthal, time : force
+    TABLE_RESET_GAME,
+    TABLE_RESET_CUE_BALL,
+    TABLE_SWITCH_MOTION_MODEL,
+    TABLE_INPUT_TYPES
+};
+
+struct TableInput {
+    uint64_t step = 0;           // stepCount of the simulation when applied
+    uint8_t type = TABLE_SHOOT_CUE;
+    float value = 0.0f;
+    float time = 0.0f;
+
+    TableInput() {}
+    TableInput(TableInputType type, float value = 0.0f, float time = 0.0f) :
+        type(type), value(value), time(time)
+    {}
+};
+
+#endif /* TABLE_INPUT_H */
@@ -0,0 +1,82 @@
+#ifndef TABLE_SNAPSHOT_H
+#define TABLE_SNAPSHOT_H
+
+// State of a table in one block of fixed size : the balls (kinematics, orientation, spin,
+// sleeping and pocketed flags), the cue and the step counters. Taking or restoring a
+// snapshot is a copy of a few kilobytes without allocation, for the shot search, undo
+// and rollback (see PoolSimulation::saveSnapshot).
+// The properties that do not change during a game (radius, mass, pockets, table size)
+// are not saved : a snapshot is restored to the table it was taken from, or to one set
+// up the same way.
+
+#include <array>
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+#include <cstdint>
+
+#include "ball_state.h"
+#include "cue_state.h"
+
+
+const int SNAPSHOT_MAX_BALLS = 16;
+const int SNAPSHOT_ARRAYS = 19;
+
+
+template<typename Real>
+struct BasicTableSnapshot {
+    int32_t ballCount = 0;
+    Real values[SNAPSHOT_ARRAYS][SNAPSHOT_MAX_BALLS];   // By array of the BallState, see snapshotArrays
+    uint8_t flags[SNAPSHOT_MAX_BALLS];
+    int8_t pocket[SNAPSHOT_MAX_BALLS];
+
+    CueState cue;
+    double accumulator = 0.0;
+    uint64_t stepCount = 0;
+    uint64_t stateHash = 0;
+};
+
+typedef BasicTableSnapshot<float> TableSnapshot;
+
+static_assert(std::is_trivially_copyable<TableSnapshot>::value, "a snapshot is copied as raw bytes");
+
+
+// Arrays of the BallState held by a snapshot, in the order of BasicTableSnapshot::values
+template<typename State>
+inline auto snapshotArrays(State& s) -> std::array<decltype(&s.x), SNAPSHOT_ARRAYS> {
+    return {{&s.x, &s.y, &s.z, &s.lx, &s.ly, &s.lz, &s.vx, &s.vy, &s.vz, &s.ax, &s.ay, &s.az,
+             &s.wx, &s.wy, &s.wz, &s.qw, &s.qx, &s.qy, &s.qz}};
+}
+
+// Return false if there are more balls than a snapshot holds
+template<typename Real>
+inline bool saveBalls(const BasicBallState<Real>& s, BasicTableSnapshot<Real>& snapshot) {
+    int count = s.size();
+    if (count > SNAPSHOT_MAX_BALLS) return false;
+
+    snapshot.ballCount = count;
+    auto arrays = snapshotArrays(s);
+    for (int a = 0; a < SNAPSHOT_ARRAYS; a++) {
+        std::copy(arrays[a]->begin(), arrays[a]->end(), snapshot.values[a]);
+    }
+    std::copy(s.flags.begin(), s.flags.end(), snapshot.flags);
+    std::copy(s.pocket.begin(), s.pocket.end(), snapshot.pocket);
+    return true;
+}
+
+// Return false if the table does not have the balls of the snapshot
+template<typename Real>
+inline bool restoreBalls(BasicBallState<Real>& s, const BasicTableSnapshot<Real>& snapshot) {
+    int count = snapshot.ballCount;
+    if (count != s.size()) return false;
+
+    auto arrays = snapshotArrays(s);
+    for (int a = 0; a < SNAPSHOT_ARRAYS; a++) {
+        std::copy(snapshot.values[a], snapshot.values[a] + count, arrays[a]->begin());
+    }
+    std::copy(snapshot.flags, snapshot.flags + count, s.flags.begin());
+    std::copy(snapshot.pocket, snapshot.pocket + count, s.pocket.begin());
+    return true;
+}
+
+#endif /* TABLE_SNAPSHOT_H */
@@ -0,0 +1,157 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+// Work-stealing thread pool : every worker has its own queue of tasks, takes the
+// newest task of its queue and, when it is empty, steals the oldest task of
+// another worker. Tasks receive the index of the worker running them, so the
+// caller can give every worker its own scratch memory.
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <algorithm>
+
+
+class ThreadPool
+{
+public:
+    typedef std::function<void(int)> Task;   // Argument : index of the worker
+
+    // threadCount <= 0 : one worker per hardware thread
+    explicit ThreadPool(int threadCount = 0) {
+        if (threadCount <= 0) threadCount = std::max(1, (int)std::thread::hardware_concurrency());
+
+        for (int w = 0; w < threadCount; w++) {
+            queues.emplace_back(new WorkerQueue());
+        }
+        for (int w = 0; w < threadCount; w++) {
+            threads.emplace_back(&ThreadPool::run, this, w);
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+        wakeUp.notify_all();
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // The queues are all created before the first worker starts, unlike the threads
+    int size() const {
+        return (int)queues.size();
+    }
+
+    // Queue a task on the next worker (round robin)
+    void submit(Task task) {
+        int w = nextQueue++ % size();
+        push(w, std::move(task));
+    }
+
+    // Block until every submitted task is done
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this] { return pending == 0; });
+    }
+
+    // Call f(begin, end, worker) on chunks of grain items covering [0, count) and wait for them
+    template<typename F>
+    void parallelFor(int count, int grain, F f) {
+        grain = std::max(1, grain);
+        int chunks = (count + grain - 1) / grain;
+
+        for (int c = 0; c < chunks; c++) {
+            int begin = c * grain;
+            int end = std::min(count, begin + grain);
+            push(c % size(), [f, begin, end](int worker) { f(begin, end, worker); });
+        }
+        wait();
+    }
+
+private:
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::vector<std::thread> threads;
+
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    std::condition_variable done;
+    bool stop = false;
+
+    std::atomic<int> queued{0};    // Tasks waiting in the queues
+    std::atomic<int> pending{0};   // Tasks submitted and not finished
+    std::atomic<unsigned> nextQueue{0};
+
+    void push(int w, Task task) {
+        pending++;
+        {
+            std::lock_guard<std::mutex> lock(queues[w]->mutex);
+            queues[w]->tasks.push_back(std::move(task));
+        }
+        queued++;
+
+        // Taking the lock makes sure a worker is not between its check and its wait
+        { std::lock_guard<std::mutex> lock(mutex); }
+        wakeUp.notify_one();
+    }
+
+    bool pop(int w, Task& task) {
+        WorkerQueue& queue = *queues[w];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty()) return false;
+
+        task = std::move(queue.tasks.back());
+        queue.tasks.pop_back();
+        queued--;
+        return true;
+    }
+
+    bool steal(int w, Task& task) {
+        for (int k = 1; k < size(); k++) {
+            WorkerQueue& queue = *queues[(w + k) % size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.tasks.empty()) continue;
+
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            queued--;
+            return true;
+        }
+        return false;
+    }
+
+    void run(int w) {
+        while (true) {
+            Task task;
+            if (pop(w, task) || steal(w, task)) {
+                task(w);
+                if (--pending == 0) {
+                    { std::lock_guard<std::mutex> lock(mutex); }
+                    done.notify_all();
+                }
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeUp.wait(lock, [this] { return stop || queued > 0; });
+            if (stop && queued == 0) return;
+        }
+    }
+};
+
+#endif /* THREAD_POOL_H */
@@ -0,0 +1,54 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+// Lock-free triple buffer between one writer thread and one reader thread.
+// The writer fills its back buffer and publishes it, the reader takes the last
+// published buffer. Neither side ever waits for the other : the writer always
+// has a free buffer, and the reader keeps its buffer until a newer one is published.
+// Frames published between two reads are skipped.
+
+#include <atomic>
+
+
+template<typename T>
+class TripleBuffer
+{
+public:
+    // Writer : buffer to fill, owned by the writer until publish
+    T& back() {
+        return buffers[backIndex];
+    }
+
+    // Writer : make the back buffer the latest, and take the previous middle buffer as back buffer
+    void publish() {
+        int previous = middle.exchange(backIndex | FRESH, std::memory_order_acq_rel);
+        backIndex = previous & INDEX;
+    }
+
+    // Reader : take the latest published buffer if there is one newer than front.
+    // Return true if front changed
+    bool update() {
+        if (!(middle.load(std::memory_order_relaxed) & FRESH)) return false;
+
+        int previous = middle.exchange(frontIndex, std::memory_order_acq_rel);
+        frontIndex = previous & INDEX;
+        return true;
+    }
+
+    // Reader : buffer read, owned by the reader until the next update
+    const T& front() const {
+        return buffers[frontIndex];
+    }
+
+private:
+    static const int INDEX = 3;
+    static const int FRESH = 4;   // The middle buffer was published and not read yet
+
+    T buffers[3];
+    int backIndex = 0;    // Writer only
+    int frontIndex = 1;   // Reader only
+    char padding[64];     // Keeps middle off the cache line of the writer and reader indexes
+    std::atomic<int> middle{2};
+};
+
+#endif /* TRIPLE_BUFFER_H */
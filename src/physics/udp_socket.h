@@ -0,0 +1,114 @@
+#ifndef UDP_SOCKET_H
+#define UDP_SOCKET_H
+
+// Non-blocking UDP socket on the loopback interface (127.0.0.1), for the players of
+// a rollback match on the same machine (see rollback_peer.h).
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+class UdpSocket
+{
+public:
+    // Bound to port on the loopback interface. Check valid() : the port may be taken
+    explicit UdpSocket(uint16_t port) {
+#ifdef _WIN32
+        WSADATA data;
+        started = WSAStartup(MAKEWORD(2, 2), &data) == 0;
+        if (!started) return;
+#endif
+        handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        if (handle == INVALID_HANDLE) return;
+
+        sockaddr_in address = loopback(port);
+        bool bound = bind(handle, (const sockaddr*)&address, sizeof(address)) == 0;
+        if (!bound || !setNonBlocking()) close();
+    }
+
+    ~UdpSocket() {
+        close();
+#ifdef _WIN32
+        if (started) WSACleanup();
+#endif
+    }
+
+    UdpSocket(const UdpSocket&) = delete;
+    UdpSocket& operator=(const UdpSocket&) = delete;
+
+    bool valid() const {
+        return handle != INVALID_HANDLE;
+    }
+
+    // To the loopback interface. Return false if the datagram was not sent
+    bool send(uint16_t port, const void* data, size_t size) {
+        if (!valid()) return false;
+
+        sockaddr_in address = loopback(port);
+        return sendto(handle, (const char*)data, (int)size, 0, (const sockaddr*)&address, sizeof(address)) == (int)size;
+    }
+
+    // Next datagram received. Return its size, -1 if there is none
+    int receive(void* data, size_t capacity) {
+        if (!valid()) return -1;
+
+        int size = (int)recvfrom(handle, (char*)data, (int)capacity, 0, nullptr, nullptr);
+        return size >= 0 ? size : -1;
+    }
+
+private:
+#ifdef _WIN32
+    typedef SOCKET Handle;
+    static const Handle INVALID_HANDLE = INVALID_SOCKET;
+    bool started = false;
+#else
+    typedef int Handle;
+    static const Handle INVALID_HANDLE = -1;
+#endif
+
+    Handle handle = INVALID_HANDLE;
+
+    static sockaddr_in loopback(uint16_t port) {
+        sockaddr_in address;
+        std::memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        return address;
+    }
+
+    bool setNonBlocking() {
+#ifdef _WIN32
+        u_long enable = 1;
+        return ioctlsocket(handle, FIONBIO, &enable) == 0;
+#else
+        int flags = fcntl(handle, F_GETFL, 0);
+        return flags >= 0 && fcntl(handle, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+    }
+
+    void close() {
+        if (!valid()) return;
+#ifdef _WIN32
+        closesocket(handle);
+#else
+        ::close(handle);
+#endif
+        handle = INVALID_HANDLE;
+    }
+};
+
+#endif /* UDP_SOCKET_H */
@@ -38,12 +38,7 @@ public:
     Mesh lightswitch_mesh = Mesh(PATH_TO_OBJECTS "/room/lightswitch.obj");
 
     // Pool table
-    PoolGame poolGame = PoolGame(
-		PATH_TO_OBJECTS "/pool_table.obj",
-		PATH_TO_TEXTURE "/pool_table/colorMap.png",
-		PATH_TO_OBJECTS "/pool_ball.obj",
-		PATH_TO_TEXTURE "/pool_balls/"
-	);
+    PoolGame poolGame;
 
     // Special objects
     Mirror mirror;
@@ -57,7 +52,19 @@ public:
 
     glm::mat4 transform = glm::mat4(1.0);
 
-    RoomScene(Skybox& skybox) : 
+    // ballCount : other than BALL_COUNT, the table is a sandbox of that many balls.
+    // versusPlayer : 0 or 1 for a rollback match against another process (see PoolGame)
+    // deterministic : deterministic simulation, with checked replays
+    RoomScene(Skybox& skybox, int ballCount = BALL_COUNT, int versusPlayer = -1, bool deterministic = false) : 
+        poolGame(
+            PATH_TO_OBJECTS "/pool_table.obj",
+            PATH_TO_TEXTURE "/pool_table/colorMap.png",
+            PATH_TO_OBJECTS "/pool_ball.obj",
+            PATH_TO_TEXTURE "/pool_balls/",
+            ballCount,
+            versusPlayer,
+            deterministic
+        ),
         window(window_mesh, Texture(PATH_TO_TEXTURE "/room/window.jpg"), &skybox),
         mirror(mirror_mesh, Texture(PATH_TO_TEXTURE "/room/mirror.JPG")),
         lightBulb(bulb_mesh, Texture(PATH_TO_TEXTURE "/room/lamp_colormap.jpg")),
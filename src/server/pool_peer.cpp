@@ -0,0 +1,121 @@
+// Stand-in for the other player of a rollback match (see physics/rollback_peer.h) :
+// a headless peer whose cue is played by a bot aiming at random. Run it against the
+// game started with --versus 0 or against a second pool_peer, with some latency
+// and loss on the packets it sends to make the rollbacks happen.
+// Reports the rollbacks and their cost every second.
+//
+// usage : pool_peer [player] [seconds] [delay ms] [loss %]
+
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <chrono>
+#include <thread>
+#include <memory>
+#include <cmath>
+#include <cstdlib>
+
+#include "pool_simulation.h"
+#include "rollback_peer.h"
+
+
+// Aims at a random direction and force, then shoots, when it is its turn
+class CueBot
+{
+public:
+    explicit CueBot(uint32_t seed) : rng(seed) {}
+
+    CueInput input(const PoolSimulation& simulation, bool active) {
+        CueInput input;
+        const CueState& cue = simulation.cue;
+        if (!active || !cue.takeInput || !simulation.balls.allSleeping()) {
+            aiming = false;
+            return input;
+        }
+
+        if (!aiming) {
+            targetAngle = std::uniform_real_distribution<float>(0.0f, 360.0f)(rng);
+            targetDistance = std::uniform_real_distribution<float>(DISTANCE_MIN, DISTANCE_MAX)(rng);
+            aiming = true;
+        }
+
+        float angle = std::fmod(targetAngle - cue.azimuthal + 540.0f, 360.0f) - 180.0f;
+        float distance = targetDistance - cue.distance;
+        if (std::abs(angle) > ROTATE_SPEED * ROLLBACK_TICK_TIME) input.turn = angle > 0.0f ? 1 : -1;
+        else if (std::abs(distance) > DISTANCE_SPEED * ROLLBACK_TICK_TIME) input.move = distance > 0.0f ? 1 : -1;
+        else {
+            input.buttons = CUE_SHOOT;
+            aiming = false;
+        }
+        return input;
+    }
+
+private:
+    std::mt19937 rng;
+    bool aiming = false;
+    float targetAngle = 0.0f;
+    float targetDistance = DISTANCE_MIN;
+};
+
+
+int main(int argc, char* argv[]) {
+    int player = argc > 1 ? glm::clamp(std::atoi(argv[1]), 0, 1) : 1;
+    double seconds = argc > 2 ? std::atof(argv[2]) : 30.0;
+
+    RollbackSettings settings;
+    settings.sendDelay = argc > 3 ? std::atof(argv[3]) * 1e-3 : 0.0;
+    settings.sendLoss = argc > 4 ? (float)std::atof(argv[4]) * 0.01f : 0.0f;
+
+    PoolSimulation simulation;
+    std::unique_ptr<RollbackPeer> peer(new RollbackPeer(simulation, player, settings));
+    if (!peer->connected()) {
+        std::cerr << "Cannot listen on port " << settings.port + player << std::endl;
+        return 1;
+    }
+    CueBot bot(player + 1);
+
+    std::cout << "Player " << player << ", " << settings.sendDelay * 1e3 << " ms delay, "
+              << settings.sendLoss * 100.0f << "% loss" << std::endl;
+    std::cout << std::setw(6) << "time" << std::setw(8) << "tick" << std::setw(8) << "remote" << std::setw(10) << "rollbacks"
+              << std::setw(10) << "resim" << std::setw(6) << "max" << std::setw(12) << "us/frame" << std::setw(8) << "stalls"
+              << std::setw(8) << "desync" << std::setw(8) << "turn" << std::endl;
+
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point start = Clock::now();
+    Clock::time_point last = start;
+    RollbackStats reported;
+    int second = 0;
+
+    while (std::chrono::duration<double>(last - start).count() < seconds) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        Clock::time_point now = Clock::now();
+        double deltaTime = std::chrono::duration<double>(now - last).count();
+        last = now;
+
+        const RollbackSession& session = peer->session;
+        peer->hold(bot.input(simulation, session.match().activePlayer == player));
+        peer->update(deltaTime);
+
+        if (std::chrono::duration<double>(now - start).count() < second + 1) continue;
+        second++;
+
+        // Rollbacks of the last second
+        const RollbackStats& stats = session.stats;
+        uint64_t ticks = stats.ticks - reported.ticks;
+        double perFrame = ticks ? (stats.rollbackNanoseconds - reported.rollbackNanoseconds) * 1e-3 / ticks : 0.0;
+        std::cout << std::setw(6) << second << std::setw(8) << session.currentTick() << std::setw(8) << session.remoteTicks()
+                  << std::setw(10) << stats.rollbacks - reported.rollbacks << std::setw(10) << stats.resimulatedTicks - reported.resimulatedTicks
+                  << std::setw(6) << stats.maxRollback << std::setw(12) << std::fixed << std::setprecision(1) << perFrame
+                  << std::setw(8) << stats.stalls - reported.stalls << std::setw(8) << stats.desyncs
+                  << std::setw(8) << (session.match().activePlayer == player ? "local" : "remote") << std::endl;
+        reported = stats;
+    }
+
+    const RollbackStats& stats = peer->session.stats;
+    std::cout << "Total : " << stats.ticks << " frames, " << stats.rollbacks << " rollbacks of "
+              << std::setprecision(1) << (stats.rollbacks ? (double)stats.resimulatedTicks / stats.rollbacks : 0.0)
+              << " frames on average, " << std::setprecision(2) << stats.rollbackMicrosecondsPerTick() << " us of rollback per frame, "
+              << stats.desyncs << " desyncs, " << peer->packetsSent << " packets sent, " << peer->packetsReceived << " received" << std::endl;
+
+    return stats.desyncs ? 1 : 0;
+}
@@ -0,0 +1,123 @@
+// Headless multi-table server : owns a number of independent tables and steps
+// them on a work-stealing thread pool, each worker with its own scratch buffers.
+// Every table plays random break shots, and is racked again when its balls are at rest.
+// Reports the aggregate physics steps per second for increasing thread counts.
+//
+// usage : pool_server [tables] [seconds per run] [max threads]
+
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <chrono>
+#include <vector>
+#include <thread>
+#include <cstdlib>
+#include <cstdint>
+
+#include "pool_simulation.h"
+#include "thread_pool.h"
+#include "../aligned_allocator.h"
+
+const double FRAME_TIME = 1.0 / 60.0;
+const int TABLES_PER_TASK = 8;
+
+
+// Counters of a worker, on their own cache line
+struct alignas(64) WorkerStats {
+    uint64_t steps = 0;
+    uint64_t shots = 0;
+};
+
+// operator new of C++14 ignores the alignment of WorkerStats
+typedef std::vector<WorkerStats, AlignedAllocator<WorkerStats, 64>> WorkerStatsArray;
+
+struct Table {
+    PoolSimulation simulation;
+    std::mt19937 rng;
+};
+
+// Break with some noise on the direction and the force
+void playShot(Table& table) {
+    std::uniform_real_distribution<float> angle(-95.0f, -85.0f);
+    std::uniform_real_distribution<float> force(200.0f, 300.0f);
+
+    impulseBall(table.simulation.balls, 0, force(table.rng), angle(table.rng));
+    table.simulation.stateChanged();
+}
+
+struct RunResult {
+    double seconds;
+    uint64_t steps;
+    uint64_t shots;
+};
+
+RunResult runTables(int tableCount, int threadCount, double duration) {
+    ThreadPool pool(threadCount);
+    std::vector<StepScratch> scratch(pool.size());
+    WorkerStatsArray stats(pool.size());
+
+    std::vector<Table> tables(tableCount);
+    for (int t = 0; t < tableCount; t++) {
+        tables[t].rng.seed(t);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    double elapsed = 0.0;
+
+    while (elapsed < duration) {
+        pool.parallelFor(tableCount, TABLES_PER_TASK, [&](int begin, int end, int worker) {
+            WorkerStats& workerStats = stats[worker];
+
+            for (int t = begin; t < end; t++) {
+                Table& table = tables[t];
+                PoolSimulation& simulation = table.simulation;
+
+                if (simulation.balls.allSleeping()) {
+                    simulation.resetGame();
+                    playShot(table);
+                    workerStats.shots++;
+                }
+
+                uint64_t steps = simulation.stepCount;
+                simulation.update(FRAME_TIME, scratch[worker]);
+                workerStats.steps += simulation.stepCount - steps;
+            }
+        });
+
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    RunResult result = {elapsed, 0, 0};
+    for (WorkerStats& workerStats : stats) {
+        result.steps += workerStats.steps;
+        result.shots += workerStats.shots;
+    }
+    return result;
+}
+
+int main(int argc, char* argv[]) {
+    int tableCount = argc > 1 ? std::atoi(argv[1]) : 4096;
+    double duration = argc > 2 ? std::atof(argv[2]) : 3.0;
+    int maxThreads = argc > 3 ? std::atoi(argv[3]) : (int)std::thread::hardware_concurrency();
+    if (maxThreads <= 0) maxThreads = 1;
+
+    std::cout << tableCount << " tables, " << duration << " s per run" << std::endl;
+    std::cout << std::setw(8) << "threads" << std::setw(18) << "table steps/s" << std::setw(14) << "shots/s"
+              << std::setw(10) << "speedup" << std::setw(12) << "efficiency" << std::endl;
+
+    double baseRate = 0.0;
+    for (int threads = 1; ; threads = glm::min(threads * 2, maxThreads)) {
+        RunResult result = runTables(tableCount, threads, duration);
+        double rate = result.steps / result.seconds;
+        if (threads == 1) baseRate = rate;
+
+        std::cout << std::setw(8) << threads << std::setw(18) << std::fixed << std::setprecision(0) << rate
+                  << std::setw(14) << result.shots / result.seconds
+                  << std::setw(10) << std::setprecision(2) << rate / baseRate
+                  << std::setw(12) << rate / baseRate / threads << std::endl;
+
+        if (threads == maxThreads) break;
+    }
+
+    return 0;
+}
@@ -13,20 +13,39 @@ uniform mat4 itM;
 uniform mat4 V;
 uniform mat4 P;
 
+// Model matrices of the balls then their normal matrices, a texel per column (ball_transforms.h)
+uniform samplerBuffer u_ballMatrices;
+// 1 + index of the ball drawn, 0 : M and itM
+uniform int u_ball;
+
 out vec3 v_frag_coord;
 out vec3 v_normal;
 out vec2 v_tex;
 out mat3 v_TBN;
 
+mat4 ballMatrix(int m) {
+    int t = 4 * m;
+    return mat4(texelFetch(u_ballMatrices, t), texelFetch(u_ballMatrices, t + 1),
+                texelFetch(u_ballMatrices, t + 2), texelFetch(u_ballMatrices, t + 3));
+}
+
 void main() {
-    vec4 frag_coord = M*vec4(position, 1.0);
+    mat4 model = M;
+    mat4 normalMatrix = itM;
+    if (u_ball > 0) {
+        int balls = textureSize(u_ballMatrices) / 8;
+        model = ballMatrix(u_ball - 1);
+        normalMatrix = ballMatrix(balls + u_ball - 1);
+    }
+
+    vec4 frag_coord = model*vec4(position, 1.0);
     gl_Position = P*V*frag_coord;
-    v_normal = vec3(itM * vec4(normal, 1.0));
+    v_normal = vec3(normalMatrix * vec4(normal, 1.0));
     v_frag_coord = frag_coord.xyz;
     v_tex = tex_coords;
 
-    vec3 T = length(tangent) > 0.0 ? normalize(vec3(M * vec4(tangent, 0.0))) : vec3(0.0);
-    vec3 B = length(bitangent) > 0.0 ? normalize(vec3(M * vec4(bitangent, 0.0))) : vec3(0.0);
+    vec3 T = length(tangent) > 0.0 ? normalize(vec3(model * vec4(tangent, 0.0))) : vec3(0.0);
+    vec3 B = length(bitangent) > 0.0 ? normalize(vec3(model * vec4(bitangent, 0.0))) : vec3(0.0);
     vec3 N = normalize(v_normal);
     v_TBN = mat3(T, B, N);
 }
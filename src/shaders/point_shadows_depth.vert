@@ -5,7 +5,18 @@ layout (location = 0) in vec3 position;
 
 uniform mat4 M;
 
+// Model matrices of the balls then their normal matrices, a texel per column (ball_transforms.h)
+uniform samplerBuffer u_ballMatrices;
+// 1 + index of the ball drawn, 0 : M
+uniform int u_ball;
+
 void main()
 {
-    gl_Position = M * vec4(position, 1.0);
+    mat4 model = M;
+    if (u_ball > 0) {
+        int t = 4 * (u_ball - 1);
+        model = mat4(texelFetch(u_ballMatrices, t), texelFetch(u_ballMatrices, t + 1),
+                     texelFetch(u_ballMatrices, t + 2), texelFetch(u_ballMatrices, t + 3));
+    }
+    gl_Position = model * vec4(position, 1.0);
 }
\ No newline at end of file